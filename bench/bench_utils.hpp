@@ -0,0 +1,119 @@
+#pragma once
+
+// Measurement and JSON helpers shared by TBD_bench and TBD_replay
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <renderer/rendering_dag/rendering_dag.hpp>
+#include <renderer/vulkan/vulkan_rhi.hpp>
+#include <string_view>
+#include <vector>
+
+namespace TBD::Bench {
+
+inline constexpr uint32_t WarmupFrames = 20;
+
+struct Percentiles {
+    float averageMs = 0.f;
+    float p50Ms = 0.f;
+    float p95Ms = 0.f;
+    float p99Ms = 0.f;
+    float maxMs = 0.f;
+    uint32_t sampleCount = 0;
+};
+
+inline Percentiles computePercentiles(std::vector<float> samples)
+{
+    if (samples.empty()) {
+        return {};
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](float p) { return samples[static_cast<size_t>(p * float(samples.size() - 1) + 0.5f)]; };
+
+    float sum = 0.f;
+    for (float sample : samples) {
+        sum += sample;
+    }
+
+    return Percentiles {
+        .averageMs = sum / float(samples.size()),
+        .p50Ms = percentile(0.5f),
+        .p95Ms = percentile(0.95f),
+        .p99Ms = percentile(0.99f),
+        .maxMs = samples.back(),
+        .sampleCount = static_cast<uint32_t>(samples.size())
+    };
+}
+
+struct MeasuredFrames {
+    Percentiles cpuFrame;
+    Percentiles gpuFrame;
+    double framesPerSecond = 0.0;
+};
+
+// Renders WarmupFrames unmeasured frames, then frameCount measured ones
+inline MeasuredFrames measureFrames(VulkanRHI& rhi, uint32_t frameCount)
+{
+    const uint32_t framesInFlight = rhi.getFramesInFlight();
+    std::vector<float> cpuSamples;
+    std::vector<float> gpuSamples;
+    cpuSamples.reserve(frameCount);
+    gpuSamples.reserve(frameCount);
+
+    // The GPU time of a frame is read back when its frame in flight is reused, framesInFlight frames later,
+    // the extra frames at the end only collect the GPU times of the measured ones
+    const RenderingDAG rdag {};
+    const uint32_t totalFrames = WarmupFrames + frameCount + framesInFlight;
+    std::chrono::steady_clock::time_point measureStart;
+    std::chrono::steady_clock::time_point measureEnd;
+    for (uint32_t i = 0; i < totalFrames; ++i) {
+        if (i == WarmupFrames) {
+            measureStart = std::chrono::steady_clock::now();
+        }
+
+        const auto frameStart = std::chrono::steady_clock::now();
+        rhi.render(rdag);
+        const auto frameEnd = std::chrono::steady_clock::now();
+
+        if (i >= WarmupFrames && i < WarmupFrames + frameCount) {
+            cpuSamples.push_back(std::chrono::duration<float, std::milli>(frameEnd - frameStart).count());
+        }
+        if (i == WarmupFrames + frameCount - 1) {
+            measureEnd = frameEnd;
+        }
+
+        // 0 when the device has no timestamp support
+        if (i >= WarmupFrames + framesInFlight && rhi.getGpuFrameMs() > 0.f) {
+            gpuSamples.push_back(rhi.getGpuFrameMs());
+        }
+    }
+
+    return MeasuredFrames {
+        .cpuFrame = computePercentiles(std::move(cpuSamples)),
+        .gpuFrame = computePercentiles(std::move(gpuSamples)),
+        .framesPerSecond = frameCount / std::chrono::duration<double>(measureEnd - measureStart).count()
+    };
+}
+
+inline void writeString(std::ostream& out, std::string_view value)
+{
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+inline void writePercentiles(std::ostream& out, const Percentiles& percentiles)
+{
+    out << "{ \"average\": " << percentiles.averageMs << ", \"p50\": " << percentiles.p50Ms << ", \"p95\": " << percentiles.p95Ms
+        << ", \"p99\": " << percentiles.p99Ms << ", \"max\": " << percentiles.maxMs << ", \"samples\": " << percentiles.sampleCount << " }";
+}
+
+}
@@ -0,0 +1,131 @@
+// Replays a frame captured with --frame-capture headless and writes its CPU and GPU frame time percentiles as JSON,
+// next to the times of the captured frame, to track the cost of one frame across commits and devices
+
+#include "bench_utils.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <general/config.hpp>
+#include <misc/utils.hpp>
+#include <renderer/core/frame_capture.hpp>
+#include <renderer/vulkan/vulkan_memory_tracker.hpp>
+#include <renderer/vulkan/vulkan_rhi.hpp>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace TBD;
+using namespace TBD::Bench;
+
+namespace {
+
+constexpr uint32_t DefaultIterationCount = 200;
+
+// Same renderer state as the captured frame, without a window
+RendererConfig makeReplayConfig(const FrameCapture& capture, std::string device)
+{
+    if (capture.directOutput) {
+        TBD_WARN("The frame was captured with direct output, replaying it through the HDR intermediate");
+    }
+
+    return RendererConfig {
+        .device = std::move(device),
+        .framesInFlight = std::clamp(capture.framesInFlight, RendererConfig::MinFramesInFlight, RendererConfig::MaxFramesInFlight),
+        .dynamicResolution = { .enabled = false, .minScale = capture.resolutionScale, .maxScale = capture.resolutionScale },
+        .width = capture.width,
+        .height = capture.height,
+        .headless = true,
+        .workload = capture.workload
+    };
+}
+
+// Replays fail rather than measure a different frame
+void uploadCapturedData(VulkanRHI& rhi, const FrameCapture& capture)
+{
+    for (const CapturedUpload& upload : capture.uploads) {
+        const CapturedResource& resource = capture.resources[upload.resourceId];
+        if (resource.category != static_cast<uint8_t>(MemoryCategory::StreamedTexture)) {
+            TBD_ABORT("Unsupported upload to the captured resource " << upload.resourceId << ", only the streamed texture can be restored");
+        }
+        if (!rhi.setStreamedTextureData(upload.data)) {
+            TBD_ABORT("Failed to restore the streamed texture of the capture");
+        }
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path capturePath;
+    std::string device;
+    uint32_t iterationCount = DefaultIterationCount;
+    std::filesystem::path outputPath = "replay_results.json";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--iterations" && hasValue) {
+            const std::string_view value = argv[++i];
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), iterationCount);
+            if (error != std::errc {} || end != value.data() + value.size() || iterationCount == 0) {
+                TBD_WARN("Invalid iteration count \"" << value << "\", using " << DefaultIterationCount);
+                iterationCount = DefaultIterationCount;
+            }
+        } else if (argument == "--device" && hasValue) {
+            device = argv[++i];
+        } else if (argument == "--output" && hasValue) {
+            outputPath = argv[++i];
+        } else if (capturePath.empty() && !argument.starts_with("--")) {
+            capturePath = argument;
+        } else {
+            TBD_WARN("Ignoring unknown argument \"" << argument << "\", expected a capture, --iterations, --device or --output");
+        }
+    }
+
+    if (capturePath.empty()) {
+        TBD_ABORT("Usage: " << argv[0] << " <capture> [--iterations N] [--device NAME] [--output PATH]");
+    }
+
+    FrameCapture capture;
+    if (!capture.load(capturePath)) {
+        TBD_ABORT("Failed to load the frame capture \"" << capturePath.string() << "\"");
+    }
+
+    TBD_LOG("Replaying frame " << capture.frameId << " captured on " << capture.deviceName << " at " << capture.width << "x" << capture.height
+                               << ", " << iterationCount << " iterations");
+
+    VulkanRHI rhi { nullptr, makeReplayConfig(capture, device) };
+    uploadCapturedData(rhi, capture);
+
+    const MeasuredFrames frames = measureFrames(rhi, iterationCount);
+
+    std::ofstream file { outputPath };
+    if (!file.is_open()) {
+        TBD_ABORT("Failed to open the output file \"" << outputPath.string() << "\"");
+    }
+
+    file << "{\n  \"capture\": ";
+    writeString(file, capturePath.string());
+    file << ",\n  \"capturedDevice\": ";
+    writeString(file, capture.deviceName);
+    file << ",\n  \"device\": ";
+    writeString(file, rhi.getDeviceName());
+    file << ",\n  \"frameId\": " << capture.frameId << ",\n  \"width\": " << capture.width << ",\n  \"height\": " << capture.height
+         << ",\n  \"resolutionScale\": " << capture.resolutionScale << ",\n  \"iterations\": " << iterationCount
+         << ",\n  \"captured\": { \"cpuFrameMs\": " << capture.cpuFrameMs << ", \"gpuFrameMs\": " << capture.gpuFrameMs << " }"
+         << ",\n  \"cpuFrameMs\": ";
+    writePercentiles(file, frames.cpuFrame);
+    file << ",\n  \"gpuFrameMs\": ";
+    writePercentiles(file, frames.gpuFrame);
+    file << "\n}\n";
+
+    TBD_LOG("Replay: " << frames.cpuFrame.p50Ms << "ms CPU p50, " << frames.gpuFrame.p50Ms << "ms GPU p50, captured " << capture.cpuFrameMs
+                       << "ms CPU, " << capture.gpuFrameMs << "ms GPU");
+    TBD_LOG("Replay results written to \"" << outputPath.string() << "\"");
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+// Renders scripted scenes headless for a fixed number of frames and writes their CPU and GPU frame time percentiles,
+// throughput and memory peaks as JSON, to compare commits on the same device. With --null the scenes are recorded by
+// the NullRHI instead, measuring the CPU side alone on any machine
+
+#include "bench_utils.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <general/config.hpp>
+#include <misc/utils.hpp>
+#include <renderer/null/null_rhi.hpp>
+#include <renderer/rendering_dag/rendering_dag.hpp>
+#include <renderer/vulkan/vulkan_gpu_profiler.hpp>
+#include <renderer/vulkan/vulkan_memory_tracker.hpp>
+#include <renderer/vulkan/vulkan_rhi.hpp>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+using namespace TBD;
+using namespace TBD::Bench;
+
+namespace {
+
+constexpr uint32_t DefaultFrameCount = 200;
+
+struct Scene {
+    std::string_view name;
+    uint32_t width;
+    uint32_t height;
+    RendererWorkload workload;
+
+    // What the scene stresses, counted per frame for the throughput
+    std::string_view unit;
+    double unitsPerFrame;
+};
+
+// Sized to run on software rasterizers like lavapipe in a reasonable time
+const Scene Scenes[] = {
+    { "fill-rate", 3840, 2160, {}, "pixels", 3840.0 * 2160.0 },
+    { "many-draws", 1280, 720, { .drawCount = 10000 }, "draws", 10000.0 },
+    { "many-dispatches", 256, 256, { .dispatchCount = 1000 }, "dispatches", 1000.0 },
+    { "texture-streaming", 1280, 720, { .streamedTextureSize = 2048 }, "bytes", 4.0 * 2048.0 * 2048.0 },
+};
+
+struct SceneResult {
+    const Scene* scene;
+    Percentiles cpuFrame;
+    Percentiles gpuFrame;
+    double framesPerSecond = 0.0;
+    std::vector<GpuPassStats> gpuPasses;
+    std::vector<MemoryHeapStats> heaps;
+    std::vector<MemoryCategoryStats> categories;
+
+    // NullRHI only
+    uint32_t commandsPerFrame = 0;
+    uint32_t validationErrors = 0;
+};
+
+SceneResult runScene(const Scene& scene, RendererConfig config, uint32_t frameCount, std::string& deviceName)
+{
+    config.headless = true;
+    config.width = scene.width;
+    config.height = scene.height;
+    config.workload = scene.workload;
+
+    TBD_LOG("Scene " << scene.name << ": " << frameCount << " frames at " << scene.width << "x" << scene.height);
+
+    VulkanRHI rhi { nullptr, config };
+    deviceName = rhi.getDeviceName();
+
+    const Bench::MeasuredFrames frames = Bench::measureFrames(rhi, frameCount);
+    SceneResult result {
+        .scene = &scene,
+        .cpuFrame = frames.cpuFrame,
+        .gpuFrame = frames.gpuFrame,
+        .framesPerSecond = frames.framesPerSecond,
+        .gpuPasses = rhi.getGpuPassStats()
+    };
+
+    const VulkanMemoryTracker& memory = rhi.getMemoryTracker();
+    result.heaps.assign(memory.getHeapStats().begin(), memory.getHeapStats().end());
+    for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); ++i) {
+        result.categories.push_back(memory.getCategoryStats(static_cast<MemoryCategory>(i)));
+    }
+
+    TBD_LOG("Scene " << scene.name << ": " << result.cpuFrame.p50Ms << "ms CPU p50, " << result.gpuFrame.p50Ms << "ms GPU p50, "
+                     << result.framesPerSecond << " frames/s");
+    return result;
+}
+
+// Nothing is waited for, the frame times are the recording times
+SceneResult runNullScene(const Scene& scene, RendererConfig config, uint32_t frameCount)
+{
+    config.headless = true;
+    config.width = scene.width;
+    config.height = scene.height;
+    config.workload = scene.workload;
+
+    TBD_LOG("Scene " << scene.name << ": " << frameCount << " null frames at " << scene.width << "x" << scene.height);
+
+    NullRHI rhi { config };
+
+    std::vector<float> cpuSamples;
+    cpuSamples.reserve(frameCount);
+
+    const RenderingDAG rdag {};
+    std::chrono::steady_clock::time_point measureStart;
+    for (uint32_t i = 0; i < WarmupFrames + frameCount; ++i) {
+        if (i == WarmupFrames) {
+            measureStart = std::chrono::steady_clock::now();
+        }
+
+        rhi.render(rdag);
+
+        if (i >= WarmupFrames) {
+            cpuSamples.push_back(rhi.getFramePacing().getLast().frameMs);
+        }
+    }
+    const auto measureEnd = std::chrono::steady_clock::now();
+
+    SceneResult result {
+        .scene = &scene,
+        .cpuFrame = computePercentiles(std::move(cpuSamples)),
+        .framesPerSecond = frameCount / std::chrono::duration<double>(measureEnd - measureStart).count(),
+        .commandsPerFrame = rhi.getStats().commandCount,
+        .validationErrors = rhi.getStats().validationErrorCount
+    };
+
+    TBD_LOG("Scene " << scene.name << ": " << result.cpuFrame.p50Ms << "ms CPU p50, " << result.commandsPerFrame << " commands, "
+                     << result.framesPerSecond << " frames/s");
+    return result;
+}
+
+void writeJson(std::ostream& out, bool null, std::string_view deviceName, uint32_t frameCount, uint32_t framesInFlight, const std::vector<SceneResult>& results)
+{
+    out << "{\n  \"backend\": " << (null ? "\"null\"" : "\"vulkan\"") << ",\n  \"device\": ";
+    writeString(out, deviceName);
+    out << ",\n  \"frames\": " << frameCount << ",\n  \"warmupFrames\": " << WarmupFrames << ",\n  \"framesInFlight\": " << framesInFlight
+        << ",\n  \"scenes\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SceneResult& result = results[i];
+        const Scene& scene = *result.scene;
+
+        out << (i == 0 ? "\n" : ",\n") << "    {\n      \"name\": ";
+        writeString(out, scene.name);
+        out << ",\n      \"width\": " << scene.width << ",\n      \"height\": " << scene.height;
+
+        out << ",\n      \"cpuFrameMs\": ";
+        writePercentiles(out, result.cpuFrame);
+        out << ",\n      \"gpuFrameMs\": ";
+        writePercentiles(out, result.gpuFrame);
+
+        out << ",\n      \"throughput\": { \"framesPerSecond\": " << result.framesPerSecond << ", \"unit\": ";
+        writeString(out, scene.unit);
+        out << ", \"perSecond\": " << result.framesPerSecond * scene.unitsPerFrame << " }";
+
+        if (null) {
+            out << ",\n      \"commandsPerFrame\": " << result.commandsPerFrame << ",\n      \"validationErrors\": " << result.validationErrors << "\n    }";
+            continue;
+        }
+
+        // Over the last VulkanGpuProfiler::HistorySize frames
+        out << ",\n      \"gpuPassesMs\": {";
+        for (size_t j = 0; j < result.gpuPasses.size(); ++j) {
+            const GpuPassStats& pass = result.gpuPasses[j];
+            out << (j == 0 ? " " : ", ");
+            writeString(out, pass.name);
+            out << ": { \"p50\": " << pass.p50Ms << ", \"p95\": " << pass.p95Ms << ", \"p99\": " << pass.p99Ms << " }";
+        }
+        out << " }";
+
+        out << ",\n      \"memory\": {\n        \"heaps\": [";
+        for (size_t j = 0; j < result.heaps.size(); ++j) {
+            const MemoryHeapStats& heap = result.heaps[j];
+            out << (j == 0 ? " " : ", ") << "{ \"deviceLocal\": " << (heap.deviceLocal ? "true" : "false") << ", \"peakUsageBytes\": " << heap.peakUsage
+                << ", \"budgetBytes\": " << heap.budget << " }";
+        }
+        out << " ],\n        \"categoryPeakBytes\": {";
+        bool first = true;
+        for (size_t j = 0; j < result.categories.size(); ++j) {
+            if (result.categories[j].peakAllocationCount == 0) {
+                continue;
+            }
+            out << (first ? " " : ", ");
+            writeString(out, toString(static_cast<MemoryCategory>(j)));
+            out << ": " << result.categories[j].peakBytes;
+            first = false;
+        }
+        out << " }\n      }\n    }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    RendererConfig config {};
+    uint32_t frameCount = DefaultFrameCount;
+    std::filesystem::path outputPath = "bench_results.json";
+    std::vector<std::string_view> sceneFilter;
+    bool null = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--frames" && hasValue) {
+            const std::string_view value = argv[++i];
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), frameCount);
+            if (error != std::errc {} || end != value.data() + value.size() || frameCount == 0) {
+                TBD_WARN("Invalid frame count \"" << value << "\", using " << DefaultFrameCount);
+                frameCount = DefaultFrameCount;
+            }
+        } else if (argument == "--device" && hasValue) {
+            config.device = argv[++i];
+        } else if (argument == "--output" && hasValue) {
+            outputPath = argv[++i];
+        } else if (argument == "--scene" && hasValue) {
+            sceneFilter.push_back(argv[++i]);
+        } else if (argument == "--null") {
+            null = true;
+        } else {
+            TBD_WARN("Ignoring unknown argument \"" << argument << "\", expected --frames, --device, --output, --scene or --null");
+        }
+    }
+
+    std::string deviceName;
+    std::vector<SceneResult> results;
+    for (const Scene& scene : Scenes) {
+        if (sceneFilter.empty() || std::find(sceneFilter.begin(), sceneFilter.end(), scene.name) != sceneFilter.end()) {
+            results.push_back(null ? runNullScene(scene, config, frameCount) : runScene(scene, config, frameCount, deviceName));
+        }
+    }
+
+    if (results.empty()) {
+        TBD_ABORT("No scene matches the filter, expected fill-rate, many-draws, many-dispatches or texture-streaming");
+    }
+
+    std::ofstream file { outputPath };
+    if (!file.is_open()) {
+        TBD_ABORT("Failed to open the output file \"" << outputPath.string() << "\"");
+    }
+
+    if (null) {
+        deviceName = "null";
+    }
+
+    writeJson(file, null, deviceName, frameCount, config.framesInFlight, results);
+    TBD_LOG("Benchmark results written to \"" << outputPath.string() << "\"");
+
+    return 0;
+}
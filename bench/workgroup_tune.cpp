@@ -0,0 +1,354 @@
+// Sweeps candidate workgroup shapes for every compute shader with a specializable workgroup size, on the first suitable
+// device, and records the fastest one in the device's VulkanWorkgroupProfile which VulkanRHI loads at startup
+
+#include <algorithm>
+#include <cstdint>
+#include <misc/types.hpp>
+#include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_descriptor_set_pool.hpp>
+#include <renderer/vulkan/vulkan_pipeline.hpp>
+#include <renderer/vulkan/vulkan_pipeline_cache.hpp>
+#include <renderer/vulkan/vulkan_utils.hpp>
+#include <renderer/vulkan/vulkan_workgroup_profile.hpp>
+#include <shaders/shaders.hpp>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+using namespace TBD;
+
+namespace {
+
+constexpr VkExtent3D BenchmarkExtent { 3840, 2160, 1 };
+constexpr uint32_t WarmupIterations = 5;
+constexpr uint32_t Iterations = 50;
+
+const Vec3u Candidates[] = {
+    { 4, 4, 1 },
+    { 8, 4, 1 },
+    { 4, 8, 1 },
+    { 8, 8, 1 },
+    { 16, 8, 1 },
+    { 8, 16, 1 },
+    { 16, 16, 1 },
+    { 32, 4, 1 },
+    { 4, 32, 1 },
+    { 32, 8, 1 },
+    { 8, 32, 1 },
+    { 32, 32, 1 },
+    { 64, 1, 1 },
+    { 64, 4, 1 },
+    { 128, 1, 1 },
+    { 256, 1, 1 },
+};
+
+struct BenchmarkContext {
+    VkInstance instance;
+    VkPhysicalDevice gpu;
+    VkPhysicalDeviceLimits limits;
+    VKUtils::DeviceCapabilities capabilities;
+    VkDevice device;
+    VkQueue queue;
+    VmaAllocator allocator;
+    VkCommandPool commandPool;
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+    VkQueryPool queryPool;
+};
+
+struct StorageImage {
+    VkImage image;
+    VkImageView view;
+    VmaAllocation allocation;
+};
+
+void submitAndWait(const BenchmarkContext& context)
+{
+    vkEndCommandBuffer(context.commandBuffer);
+
+    vkResetFences(context.device, 1, &context.fence);
+    VKUtils::submitCommandBuffer(context.queue, VkSemaphoreSubmitInfo {}, VkSemaphoreSubmitInfo {}, context.commandBuffer, context.fence);
+
+    if (vkWaitForFences(context.device, 1, &context.fence, VK_TRUE, TBD_MAX_T(uint64_t)) != VK_SUCCESS) {
+        TBD_ABORT_VK("GPU stall detected");
+    }
+}
+
+bool isCandidateSupported(const BenchmarkContext& context, const ShaderReflection& shader, Vec3u candidate)
+{
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (candidate[i] > context.limits.maxComputeWorkGroupSize[i]) {
+            return false;
+        }
+
+        // Dimensions without a specialization constant are fixed by the shader
+        if (shader.workgroupSizeSpecIds[i] == InvalidSpecId && candidate[i] != shader.workgroupSize[i]) {
+            return false;
+        }
+    }
+
+    return candidate.x * candidate.y * candidate.z <= context.limits.maxComputeWorkGroupInvocations;
+}
+
+// Format of the images the shader writes in the renderer, VK_FORMAT_UNDEFINED when the device can't run it. The direct
+// output shaders store to the UNORM swapchain images without a format, see VKUtils::selectSurfaceFormat
+VkFormat getTargetFormat(const BenchmarkContext& context, const ShaderReflection& shader)
+{
+    if (&shader != &Shaders::GradientDirectComp) {
+        return VK_FORMAT_R16G16B16A16_SFLOAT;
+    }
+
+    if (!context.capabilities.storageImageWriteWithoutFormat) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    for (VkFormat format : { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM }) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(context.gpu, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) {
+            return format;
+        }
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+StorageImage createStorageImage(const BenchmarkContext& context, VkFormat format)
+{
+    StorageImage result;
+
+    VkImageCreateInfo imageCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = BenchmarkExtent,
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    VmaAllocationCreateInfo allocCreateInfo {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        .requiredFlags = VkMemoryPropertyFlags { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT }
+    };
+
+    if (vmaCreateImage(context.allocator, &imageCreateInfo, &allocCreateInfo, &result.image, &result.allocation, nullptr) != VK_SUCCESS) {
+        TBD_ABORT_VK("VMA image creation failed");
+    }
+
+    VkImageViewCreateInfo viewCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = result.image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = imageCreateInfo.format,
+        .subresourceRange = VKUtils::makeSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT)
+    };
+
+    if (vkCreateImageView(context.device, &viewCreateInfo, nullptr, &result.view) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to create Vulkan image view");
+    }
+
+    VKUtils::beginCommandBuffer(context.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    VkImageMemoryBarrier2 barrier {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .image = result.image,
+        .subresourceRange = VKUtils::makeSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT)
+    };
+
+    VkDependencyInfo depInfo {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &barrier
+    };
+
+    vkCmdPipelineBarrier2(context.commandBuffer, &depInfo);
+    submitAndWait(context);
+
+    return result;
+}
+
+// Median GPU time of a full screen dispatch in milliseconds
+float measure(const BenchmarkContext& context, const ShaderReflection& shader, VulkanPipeline& pipeline, VkDescriptorSet descriptorSet, float timestampPeriod)
+{
+    std::vector<float> timings;
+    timings.reserve(Iterations);
+
+    for (uint32_t i = 0; i < WarmupIterations + Iterations; ++i) {
+        VKUtils::beginCommandBuffer(context.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+        vkCmdResetQueryPool(context.commandBuffer, context.queryPool, 0, 2);
+        vkCmdBindDescriptorSets(context.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getLayout(), 0, 1, &descriptorSet, 0, nullptr);
+
+        // By convention compute shaders take their dispatch resolution as the first member of their push constant block
+        if (!shader.pushConstantRanges.empty()) {
+            pipeline.pushConstants(context.commandBuffer, Vec2i { BenchmarkExtent.width, BenchmarkExtent.height });
+        }
+
+        vkCmdWriteTimestamp2(context.commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, context.queryPool, 0);
+        pipeline.dispatch(context.commandBuffer, { BenchmarkExtent.width, BenchmarkExtent.height, 1 });
+        vkCmdWriteTimestamp2(context.commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, context.queryPool, 1);
+
+        submitAndWait(context);
+
+        uint64_t timestamps[2];
+        vkGetQueryPoolResults(context.device, context.queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+        if (i >= WarmupIterations) {
+            timings.emplace_back((timestamps[1] - timestamps[0]) * timestampPeriod / 1e6f);
+        }
+    }
+
+    std::nth_element(timings.begin(), timings.begin() + timings.size() / 2, timings.end());
+    return timings[timings.size() / 2];
+}
+
+void tuneShader(const BenchmarkContext& context, const ShaderReflection& shader, float timestampPeriod, VulkanWorkgroupProfile& profile)
+{
+    const bool storageImagesOnly = std::all_of(shader.bindings.begin(), shader.bindings.end(), [](const ShaderBinding& binding) {
+        return binding.set == 0 && binding.count == 1 && binding.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    });
+
+    if (!storageImagesOnly) {
+        TBD_WARN("Skipping \"" << shader.name << "\", only storage image bindings are supported by the benchmark");
+        return;
+    }
+
+    const VkFormat format = getTargetFormat(context, shader);
+    if (format == VK_FORMAT_UNDEFINED) {
+        TBD_WARN("Skipping \"" << shader.name << "\", the device can't store to its target images");
+        return;
+    }
+
+    VulkanDescriptorSetPool descriptorSetPool { context.device, 1, shader.stage, shader.bindings, 1 };
+    VkDescriptorSet descriptorSet = descriptorSetPool.getDescriptorSet(context.device, 0);
+
+    std::vector<StorageImage> images;
+    for (const ShaderBinding& binding : shader.bindings) {
+        const StorageImage& image = images.emplace_back(createStorageImage(context, format));
+
+        VkDescriptorImageInfo imageInfo {
+            .imageView = image.view,
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+        };
+
+        VkWriteDescriptorSet descWrite {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptorSet,
+            .dstBinding = binding.binding,
+            .descriptorCount = 1,
+            .descriptorType = binding.type,
+            .pImageInfo = &imageInfo
+        };
+
+        vkUpdateDescriptorSets(context.device, 1, &descWrite, 0, nullptr);
+    }
+
+    VulkanPipelineCache pipelineCache { context.device };
+
+    Vec3u bestWorkgroupSize { 0 };
+    float bestTiming = TBD_MAX_T(float);
+
+    for (Vec3u candidate : Candidates) {
+        if (!isCandidateSupported(context, shader, candidate)) {
+            continue;
+        }
+
+        VulkanPipeline* pipeline = pipelineCache.getPipeline(context.device,
+            PipelineDesc { .shaders { .computeShader = &shader, .workgroupSize = candidate } },
+            descriptorSetPool.getLayout());
+
+        const float timing = measure(context, shader, *pipeline, descriptorSet, timestampPeriod);
+        TBD_LOG(shader.name << " " << candidate.x << "x" << candidate.y << "x" << candidate.z << ": " << timing << "ms");
+
+        if (timing < bestTiming) {
+            bestTiming = timing;
+            bestWorkgroupSize = candidate;
+        }
+    }
+
+    if (bestTiming != TBD_MAX_T(float)) {
+        TBD_LOG(shader.name << " fastest workgroup size: " << bestWorkgroupSize.x << "x" << bestWorkgroupSize.y << "x" << bestWorkgroupSize.z << " (" << bestTiming << "ms)");
+        profile.setWorkgroupSize(shader, bestWorkgroupSize);
+    }
+
+    pipelineCache.release(context.device);
+    descriptorSetPool.releasePool(context.device);
+
+    for (const StorageImage& image : images) {
+        vkDestroyImageView(context.device, image.view, nullptr);
+        vmaDestroyImage(context.allocator, image.image, image.allocation);
+    }
+}
+
+}
+
+int main()
+{
+    BenchmarkContext context;
+
+    context.instance = VKUtils::createVkInstance({});
+
+    auto [gpu, queues] = VKUtils::selectPhysicalDevice(context.instance, nullptr);
+    context.gpu = gpu;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(context.gpu, &properties);
+    context.limits = properties.limits;
+
+    if (!context.limits.timestampComputeAndGraphics) {
+        TBD_ABORT_VK("The device doesn't support timestamps on the graphics queue");
+    }
+
+    // Same features as the renderer so its shaders can be built, without the swapchain extensions as there is no surface
+    context.capabilities = VKUtils::queryDeviceCapabilities(context.gpu);
+    context.device = VKUtils::createLogicalDevice(context.gpu, queues, context.capabilities, false);
+    context.allocator = VKUtils::createVMAAllocator(context.instance, context.gpu, context.device);
+    vkGetDeviceQueue(context.device, queues.GraphicsQueueFamilyID, 0, &context.queue);
+
+    context.commandPool = VKUtils::createCommandPool(context.device, queues.GraphicsQueueFamilyID);
+    VKUtils::allocateCommandBuffers(context.device, context.commandPool, 1, &context.commandBuffer);
+    context.fence = VKUtils::createFence(context.device);
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2
+    };
+
+    if (vkCreateQueryPool(context.device, &queryPoolCreateInfo, nullptr, &context.queryPool) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to create Vulkan query pool");
+    }
+
+    const std::filesystem::path profilePath = VulkanWorkgroupProfile::getPath(context.gpu);
+
+    VulkanWorkgroupProfile profile;
+    profile.load(profilePath);
+
+    for (const ShaderReflection* shader : Shaders::All) {
+        if (shader->stage == VK_SHADER_STAGE_COMPUTE_BIT && shader->hasSpecializableWorkgroupSize()) {
+            tuneShader(context, *shader, properties.limits.timestampPeriod, profile);
+        }
+    }
+
+    if (profile.save(profilePath)) {
+        TBD_LOG("Workgroup profile written to " << profilePath);
+    }
+
+    vkDestroyQueryPool(context.device, context.queryPool, nullptr);
+    vkDestroyFence(context.device, context.fence, nullptr);
+    vkDestroyCommandPool(context.device, context.commandPool, nullptr);
+    vmaDestroyAllocator(context.allocator);
+    vkDestroyDevice(context.device, nullptr);
+    vkDestroyInstance(context.instance, nullptr);
+
+    return 0;
+}
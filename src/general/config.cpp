@@ -0,0 +1,158 @@
+#include "config.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <misc/utils.hpp>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace TBD {
+
+namespace {
+
+    [[nodiscard]] bool parseUInt(std::string_view value, uint32_t& result)
+    {
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+        return error == std::errc {} && end == value.data() + value.size();
+    }
+
+    [[nodiscard]] bool parseFloat(std::string_view value, float& result)
+    {
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+        return error == std::errc {} && end == value.data() + value.size();
+    }
+
+    [[nodiscard]] bool parsePresentMode(std::string_view value, PresentMode& result)
+    {
+        static constexpr std::pair<std::string_view, PresentMode> modes[] = {
+            { "fifo", PresentMode::Fifo },
+            { "fifo-relaxed", PresentMode::FifoRelaxed },
+            { "mailbox", PresentMode::Mailbox },
+            { "immediate", PresentMode::Immediate },
+        };
+
+        for (auto [name, mode] : modes) {
+            if (value == name) {
+                result = mode;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+}
+
+EngineConfig EngineConfig::fromCommandLine(int argc, char** argv)
+{
+    EngineConfig config {};
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (argument == "--frames-in-flight" && hasValue) {
+            uint32_t framesInFlight;
+            if (parseUInt(argv[++i], framesInFlight)) {
+                config.renderer.framesInFlight = std::clamp(framesInFlight, RendererConfig::MinFramesInFlight, RendererConfig::MaxFramesInFlight);
+            } else {
+                TBD_WARN("Invalid frames in flight count \"" << argv[i] << "\"");
+            }
+        } else if (argument == "--device" && hasValue) {
+            config.renderer.device = argv[++i];
+        } else if (argument == "--present-mode" && hasValue) {
+            if (!parsePresentMode(argv[++i], config.renderer.presentMode)) {
+                TBD_WARN("Invalid present mode \"" << argv[i] << "\", expected fifo, fifo-relaxed, mailbox or immediate");
+            }
+        } else if (argument == "--low-latency") {
+            config.renderer.lowLatency = true;
+        } else if (argument == "--dynamic-resolution") {
+            config.renderer.dynamicResolution.enabled = true;
+        } else if (argument == "--target-frame-ms" && hasValue) {
+            float targetFrameMs;
+            if (parseFloat(argv[++i], targetFrameMs) && targetFrameMs > 0.f) {
+                config.renderer.dynamicResolution.targetFrameMs = targetFrameMs;
+            } else {
+                TBD_WARN("Invalid target frame time \"" << argv[i] << "\"");
+            }
+        } else if (argument == "--min-resolution-scale" && hasValue) {
+            float minScale;
+            if (parseFloat(argv[++i], minScale) && minScale > 0.f && minScale <= 1.f) {
+                config.renderer.dynamicResolution.minScale = minScale;
+            } else {
+                TBD_WARN("Invalid minimum resolution scale \"" << argv[i] << "\", expected a value in ]0, 1]");
+            }
+        } else if (argument == "--headless") {
+            config.renderer.headless = true;
+        } else if (argument == "--resolution" && hasValue) {
+            const std::string_view resolution = argv[++i];
+            const size_t separator = resolution.find('x');
+            uint32_t width, height;
+            if (separator != std::string_view::npos && parseUInt(resolution.substr(0, separator), width) && parseUInt(resolution.substr(separator + 1), height) && width != 0 && height != 0) {
+                config.renderer.width = width;
+                config.renderer.height = height;
+            } else {
+                TBD_WARN("Invalid resolution \"" << resolution << "\", expected WIDTHxHEIGHT");
+            }
+        } else if (argument == "--direct-output") {
+            config.renderer.directOutput = true;
+        } else if (argument == "--capture-dir" && hasValue) {
+            config.renderer.captureDirectory = argv[++i];
+        } else if (argument == "--memory-stats" && hasValue) {
+            config.renderer.memoryStatsPath = argv[++i];
+        } else if (argument == "--pipeline-statistics") {
+            config.renderer.pipelineStatistics = true;
+        } else if (argument == "--frame-capture" && hasValue) {
+            config.renderer.frameCapturePath = argv[++i];
+        } else if (argument == "--frame-capture-at" && hasValue) {
+            if (!parseUInt(argv[++i], config.renderer.frameCaptureId)) {
+                TBD_WARN("Invalid frame capture id \"" << argv[i] << "\", capturing the slowest frame");
+                config.renderer.frameCaptureId = 0;
+            }
+        } else if (argument == "--hud") {
+            config.renderer.hud = true;
+        } else if (argument == "--on-demand") {
+            config.onDemand = true;
+        } else if (argument == "--profile-output" && hasValue) {
+            config.profileOutput = argv[++i];
+        } else if (argument == "--frames" && hasValue) {
+            if (!parseUInt(argv[++i], config.frameCount)) {
+                TBD_WARN("Invalid frame count \"" << argv[i] << "\"");
+            }
+        } else {
+            TBD_WARN("Ignoring unknown argument \"" << argument << "\"");
+        }
+    }
+
+    if (config.renderer.headless && config.onDemand) {
+        TBD_WARN("On demand rendering requires a window, rendering continuously");
+        config.onDemand = false;
+    }
+
+    if (!config.renderer.headless && !config.renderer.captureDirectory.empty()) {
+        TBD_WARN("Frame capture is only supported in headless mode");
+    }
+
+#if !TBD_PROFILE
+    if (!config.profileOutput.empty()) {
+        TBD_WARN("CPU profiling zones are compiled out, configure with -DTBD_PROFILE=ON to write a trace");
+    }
+#endif
+
+#if !TBD_HUD
+    if (config.renderer.hud) {
+        TBD_WARN("The performance HUD is compiled out of release builds");
+        config.renderer.hud = false;
+    }
+#else
+    if (config.renderer.hud && config.renderer.headless) {
+        TBD_WARN("The performance HUD requires a window");
+        config.renderer.hud = false;
+    }
+#endif
+
+    return config;
+}
+
+} // namespace TBD
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <misc/utils.hpp>
+#include <string>
+
+namespace TBD {
+
+enum class PresentMode {
+    Fifo, // Vsync, always supported
+    FifoRelaxed, // Vsync, tears when a frame is late
+    Mailbox, // Latest frame shown at vblank, falls back to Immediate
+    Immediate, // No vsync, falls back to Mailbox
+};
+
+struct DynamicResolutionConfig {
+    bool enabled = false;
+
+    // Scale applied to both axes of the window resolution
+    float minScale = 0.5f;
+    float maxScale = 1.f;
+
+    // GPU time the render resolution is adjusted to fit in
+    float targetFrameMs = 1000.f / 60.f;
+};
+
+// Synthetic load added to every frame, used by the benchmark scenes
+struct RendererWorkload {
+    // Triangles drawn in a grid, each with its own push constants, 1 covers the render target
+    uint32_t drawCount = 1;
+
+    // Gradient dispatches over the whole render target, each waiting for the previous one
+    uint32_t dispatchCount = 1;
+
+    // Side of an RGBA8 texture uploaded from the CPU every frame, 0 disables streaming
+    uint32_t streamedTextureSize = 0;
+};
+
+struct RendererConfig {
+    static constexpr uint32_t MinFramesInFlight = 1;
+    static constexpr uint32_t MaxFramesInFlight = 3;
+
+    // Index in the enumeration order or part of the device name, the best scored device when empty
+    std::string device;
+
+    // 1 for the lowest latency, 3 for throughput
+    uint32_t framesInFlight = 2;
+
+    // Falls back to Fifo when the surface doesn't support the mode
+    PresentMode presentMode = PresentMode::Fifo;
+
+    // Before starting a frame, the CPU waits for the oldest frame still in flight, the previous one only with a single
+    // frame in flight, to be presented through present wait when available, or completed by the GPU otherwise
+    bool lowLatency = false;
+
+    DynamicResolutionConfig dynamicResolution;
+
+    // Initial window size, fixed render size in headless mode
+    uint32_t width = 1600;
+    uint32_t height = 800;
+
+    // No window, surface nor swapchain, frames are rendered to a ring of offscreen images
+    bool headless = false;
+
+    // Frames are rendered straight to storage capable swapchain images without the HDR intermediate and its blit,
+    // ignored with dynamic resolution or when the surface doesn't allow it
+    bool directOutput = false;
+
+    // Headless only, every frame is written there as a PPM image when set
+    std::filesystem::path captureDirectory;
+
+    // Detailed VMA statistics JSON written at shutdown when set, allocations are named after their category
+    std::filesystem::path memoryStatsPath;
+
+    // Shader invocation counts of the GPU profiler passes, reported at shutdown, ignored when the device can't query them
+    bool pipelineStatistics = false;
+
+    RendererWorkload workload;
+
+    // A frame is written there as a FrameCapture for TBD_replay when set
+    std::filesystem::path frameCapturePath;
+
+    // Frame to capture, 0 for the slowest CPU frame of the run, written at shutdown
+    uint32_t frameCaptureId = 0;
+
+    // Performance overlay over the final image, needs a window and a TBD_HUD build, compiled out in release builds
+    bool hud = false;
+};
+
+struct EngineConfig {
+    RendererConfig renderer;
+
+    // Stops after that many frames, 0 runs until the window is closed
+    uint32_t frameCount = 0;
+
+    // Frames are only rendered when a window event or Engine::requestRedraw marked them dirty,
+    // the engine sleeps in between, ignored in headless mode
+    bool onDemand = false;
+
+    // CPU zones are written there as a Chrome trace when the engine stops, requires a TBD_PROFILE build
+    std::filesystem::path profileOutput;
+
+    // Unknown or malformed arguments are ignored with a warning
+    [[nodiscard]] static EngineConfig fromCommandLine(int argc, char** argv);
+};
+
+} // namespace TBD
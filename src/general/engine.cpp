@@ -1,24 +1,107 @@
 #include "engine.hpp"
+#include <chrono>
+#include <ctime>
 #include <memory>
 #include <renderer/rendering_dag/rendering_dag.hpp>
 #include <renderer/vulkan/vulkan_rhi.hpp>
 
 namespace TBD {
 
-Engine::Engine()
-    : _window {}
+Engine::Engine(const EngineConfig& config)
+    : _config { config }
 {
-    _rhi = std::make_unique<VulkanRHI>(_window);
+    if (!_config.renderer.headless) {
+        StartupTrace::Scope scope { &_startupTrace, "Window" };
+        _window = std::make_unique<Window>(_config.renderer.width, _config.renderer.height);
+    }
+
+    _rhi = std::make_unique<VulkanRHI>(_window.get(), _config.renderer, &_startupTrace);
 }
 
 Engine::~Engine() { }
 
 void Engine::run()
 {
-    while (!_window.windowClosing()) {
+    TBD_PROFILE_THREAD("Main");
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::clock_t cpuStart = std::clock();
+    const double gpuStartMs = _rhi->getTotalGpuFrameMs();
+
+    const bool onDemand = _config.onDemand && _window;
+    float idleSeconds = 0.f;
+
+    uint32_t frameCount = 0;
+    while (_config.frameCount == 0 || frameCount < _config.frameCount) {
+        if (_window && _window->windowClosing()) {
+            break;
+        }
+
+        // Nothing can be presented, sleep until the window is restored rather than spinning on skipped frames
+        if (_window && _window->isMinimized()) {
+            TBD_PROFILE_ZONE("Wait events");
+            const auto idleStart = std::chrono::steady_clock::now();
+            _window->waitEvents();
+            idleSeconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - idleStart).count();
+            continue;
+        }
 
+        // A swapchain left out of date by the last frame needs one more to catch up
+        if (onDemand && !_window->consumeDirty() && !_redrawRequested.exchange(false) && !_rhi->needsRedraw()) {
+            TBD_PROFILE_ZONE("Wait events");
+            const auto idleStart = std::chrono::steady_clock::now();
+            _window->waitEvents();
+            idleSeconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - idleStart).count();
+            continue;
+        }
+
+        TBD_PROFILE_ZONE("Frame");
+
+        const auto renderStart = StartupTrace::Clock::now();
         _rhi->render(RenderingDAG {});
-        _window.update();
+
+        if (++frameCount == 1) {
+            _startupTrace.record("First frame", renderStart, StartupTrace::Clock::now());
+            _startupTrace.report();
+        }
+
+        if (_window) {
+            TBD_PROFILE_ZONE("Window update");
+            _window->update();
+        }
+
+#if TBD_PROFILE
+        // Keeps the thread buffers from filling up, their zones are kept until the trace is written
+        if (!_config.profileOutput.empty()) {
+            Profiler::collect();
+        }
+#endif
+    }
+
+    const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    TBD_LOG(frameCount << " frames in " << seconds << "s, " << (seconds > 0.f ? frameCount / seconds : 0.f) << " FPS");
+
+    if (onDemand && seconds > 0.f) {
+        // CPU time of the whole process, every thread included
+        const float cpuSeconds = float(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        const float gpuSeconds = float(_rhi->getTotalGpuFrameMs() - gpuStartMs) / 1000.f;
+        TBD_LOG("On demand: idle " << 100.f * idleSeconds / seconds << "% of the time, CPU " << 100.f * cpuSeconds / seconds << "% of a core, GPU "
+                                   << 100.f * gpuSeconds / seconds << "% busy");
+    }
+
+#if TBD_PROFILE
+    if (!_config.profileOutput.empty()) {
+        Profiler::writeChromeTrace(_config.profileOutput);
+    }
+#endif
+}
+
+void Engine::requestRedraw()
+{
+    _redrawRequested = true;
+
+    if (_window) {
+        _window->wake();
     }
 }
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <general/config.hpp>
+#include <atomic>
+#include <general/startup_trace.hpp>
 #include <general/window.hpp>
 #include <misc/types.hpp>
 #include <misc/utils.hpp>
@@ -11,16 +14,27 @@ class VulkanRHI;
 class Engine {
     TBD_NO_COPY_MOVE(Engine)
 public:
-    Engine();
+    Engine(const EngineConfig& config = {});
 
     ~Engine();
 
     void run();
 
+    // Marks the next frame dirty in on demand mode, for scene changes and animations, can be called from any thread
+    void requestRedraw();
+
 private:
-    Window _window;
+    EngineConfig _config;
+
+    // Reported once the first frame was rendered
+    StartupTrace _startupTrace;
+
+    // nullptr in headless mode
+    Uptr<Window> _window;
 
     Uptr<VulkanRHI> _rhi;
+
+    std::atomic<bool> _redrawRequested = false;
 };
 
 } // namespace TBD
\ No newline at end of file
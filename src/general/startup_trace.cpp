@@ -0,0 +1,47 @@
+#include "startup_trace.hpp"
+#include <algorithm>
+
+namespace TBD {
+
+StartupTrace::StartupTrace()
+    : _start { Clock::now() }
+    , _mainThread { std::this_thread::get_id() }
+{
+}
+
+StartupTrace::Scope::Scope(StartupTrace* trace, std::string_view phase)
+    : _trace { trace }
+    , _phase { phase }
+    , _start { Clock::now() }
+{
+}
+
+StartupTrace::Scope::~Scope()
+{
+    if (_trace) {
+        _trace->record(_phase, _start, Clock::now());
+    }
+}
+
+void StartupTrace::record(std::string_view phase, Clock::time_point start, Clock::time_point end)
+{
+    std::lock_guard lock { _mutex };
+    _phases.emplace_back(Phase { std::string { phase }, start, end, std::this_thread::get_id() == _mainThread });
+}
+
+void StartupTrace::report() const
+{
+    std::lock_guard lock { _mutex };
+
+    std::vector<Phase> phases = _phases;
+    std::sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) { return a.start < b.start; });
+
+    auto toMs = [](Clock::duration duration) { return std::chrono::duration<float, std::milli>(duration).count(); };
+
+    TBD_LOG("Startup trace, " << toMs(Clock::now() - _start) << "ms to the first frame:");
+    for (const Phase& phase : phases) {
+        TBD_LOG("  +" << toMs(phase.start - _start) << "ms " << phase.name << ": " << toMs(phase.end - phase.start) << "ms" << (phase.mainThread ? "" : " (worker)"));
+    }
+}
+
+} // namespace TBD
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <misc/utils.hpp>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace TBD {
+
+// Time spent in each startup phase up to the first frame, phases running in parallel trace from their own thread
+class StartupTrace {
+    TBD_NO_COPY_MOVE(StartupTrace)
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StartupTrace();
+
+    // Records the phase from its construction to its destruction, does nothing without a trace
+    class Scope {
+        TBD_NO_COPY_MOVE(Scope)
+    public:
+        Scope(StartupTrace* trace, std::string_view phase);
+
+        ~Scope();
+
+    private:
+        StartupTrace* _trace;
+        std::string_view _phase;
+        Clock::time_point _start;
+    };
+
+    void record(std::string_view phase, Clock::time_point start, Clock::time_point end);
+
+    // Phases by start time with the thread they ran on, and the time since the trace creation
+    void report() const;
+
+private:
+    struct Phase {
+        std::string name;
+        Clock::time_point start;
+        Clock::time_point end;
+        bool mainThread;
+    };
+
+    const Clock::time_point _start;
+    const std::thread::id _mainThread;
+
+    mutable std::mutex _mutex;
+    std::vector<Phase> _phases;
+};
+
+} // namespace TBD
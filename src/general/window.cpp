@@ -6,22 +6,39 @@
 
 namespace TBD {
 
-Window::Window()
-    : _width { 1600 }
-    , _height { 800 }
+Window::Window(uint32_t width, uint32_t height)
+    : _width { width }
+    , _height { height }
 {
     if (!glfwInit()) {
         TBD_ABORT("GLFW init failed");
     }
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // TODO
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     _window = glfwCreateWindow(_width, _height, PROJECT_NAME, nullptr, nullptr);
 
     if (!_window) {
         TBD_ABORT("Window creation failed");
     }
 
+    // The framebuffer can differ from the requested size on high DPI displays
+    int width, height;
+    glfwGetFramebufferSize(_window, &width, &height);
+    _width = width;
+    _height = height;
+
+    glfwSetWindowUserPointer(_window, this);
+    glfwSetFramebufferSizeCallback(_window, &Window::framebufferSizeCallback);
+
+    // Any of these may change the image, on demand rendering only redraws after them
+    glfwSetWindowRefreshCallback(_window, &Window::markDirty);
+    glfwSetWindowFocusCallback(_window, [](GLFWwindow* window, int) { markDirty(window); });
+    glfwSetKeyCallback(_window, [](GLFWwindow* window, int, int, int, int) { markDirty(window); });
+    glfwSetMouseButtonCallback(_window, [](GLFWwindow* window, int, int, int) { markDirty(window); });
+    glfwSetCursorPosCallback(_window, [](GLFWwindow* window, double, double) { markDirty(window); });
+    glfwSetScrollCallback(_window, [](GLFWwindow* window, double, double) { markDirty(window); });
+
     TBD_LOG("Window creation completed");
 }
 
@@ -47,6 +64,19 @@ Window::~Window()
     return exts;
 }
 
+void Window::framebufferSizeCallback(GLFWwindow* glfwWindow, int width, int height)
+{
+    Window* window = static_cast<Window*>(glfwGetWindowUserPointer(glfwWindow));
+    window->_width = static_cast<uint32_t>(width);
+    window->_height = static_cast<uint32_t>(height);
+    window->_dirty = true;
+}
+
+void Window::markDirty(GLFWwindow* glfwWindow)
+{
+    static_cast<Window*>(glfwGetWindowUserPointer(glfwWindow))->_dirty = true;
+}
+
 [[nodiscard]] VkSurfaceKHR Window::createVkSurface(VkInstance instance) const
 {
     VkSurfaceKHR surface;
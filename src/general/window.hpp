@@ -1,6 +1,7 @@
 #pragma once
 
 #include <misc/utils.hpp>
+#include <utility>
 #include <vulkan/vulkan_core.h>
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -11,28 +12,49 @@ namespace TBD {
 class Window {
     TBD_NO_COPY_MOVE(Window)
 public:
-    Window();
+    Window(uint32_t width, uint32_t height);
 
     ~Window();
 
     [[nodiscard]] VkSurfaceKHR createVkSurface(VkInstance instance) const;
 
+    // Framebuffer size in pixels, 0 while minimized
     inline uint32_t getWidth() const { return _width; }
 
     inline uint32_t getHeight() const { return _height; }
 
+    [[nodiscard]] inline bool isMinimized() const { return _width == 0 || _height == 0; }
+
     inline void update() { glfwPollEvents(); }
 
+    // Sleeps until an event arrives or wake is called
+    inline void waitEvents() { glfwWaitEvents(); }
+
+    // Can be called from any thread
+    inline void wake() { glfwPostEmptyEvent(); }
+
+    // Set by the events changing what is on screen, resizes, exposure, focus and input, until consumed
+    [[nodiscard]] inline bool consumeDirty() { return std::exchange(_dirty, false); }
+
     [[nodiscard]] inline bool windowClosing() const { return glfwWindowShouldClose(_window); }
 
     [[nodiscard]] std::vector<const char*> requiredVulkanExtensions() const;
 
+    [[nodiscard]] inline GLFWwindow* getGlfwWindow() const { return _window; }
+
+private:
+    static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+
+    static void markDirty(GLFWwindow* window);
+
 private:
     GLFWwindow* _window;
 
     uint32_t _width;
 
     uint32_t _height;
+
+    bool _dirty = true;
 };
 
 } // namespace TBD
\ No newline at end of file
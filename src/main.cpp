@@ -1,12 +1,13 @@
 #include <misc/utils.hpp>
+#include <general/config.hpp>
 #include <general/engine.hpp>
 
 using namespace TBD;
 
-int main() {
-	Engine engine;
+int main(int argc, char** argv) {
+	Engine engine { EngineConfig::fromCommandLine(argc, argv) };
 
 	engine.run();
 	
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,263 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <misc/logger.hpp>
+#include <misc/spsc_ring.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TBD::Log {
+
+namespace {
+
+    struct Record {
+        const char* prefix;
+        const char* file;
+        uint32_t line;
+        uint16_t length;
+        bool error;
+        char text[MaxMessageLength];
+    };
+
+    // Messages of a thread, drained by the writer or a synchronous flush under the registry mutex.
+    // Messages are never dropped, a full ring blocks its thread until the writer caught up
+    using ThreadBuffer = SpscRing<Record, MessageRingCapacity>;
+
+    struct ThreadRing {
+        ThreadBuffer buffer;
+
+        // Set when the thread exits, the ring is released once drained
+        std::atomic<bool> exited = false;
+    };
+
+    struct Registry {
+        // Guards the ring list and the consumer side of every ring
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+
+        std::atomic<bool> running = true;
+
+        // Set by the first message committed since the writer last drained, the writer sleeps until then
+        std::atomic<bool> pending = false;
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+
+        // Notified after every drain, for the threads waiting on a full ring
+        std::condition_variable drained;
+        std::thread writer;
+    };
+
+    void writeRecord(const Record& record)
+    {
+        std::ostream& stream = record.error ? std::cerr : std::cout;
+        stream << record.prefix;
+        stream.write(record.text, record.length);
+        stream << " - " << record.file << ":" << record.line << "\033[0m\n";
+    }
+
+    // Messages keep their order within a thread, not across threads
+    void drainAll(Registry& registry)
+    {
+        {
+            std::lock_guard lock { registry.mutex };
+
+            bool written = false;
+            bool released = false;
+            for (std::unique_ptr<ThreadRing>& ring : registry.rings) {
+                // Read before draining, every message of an exited thread is then drained
+                const bool exited = ring->exited.load(std::memory_order_acquire);
+                written |= ring->buffer.drain(writeRecord);
+                if (exited) {
+                    ring.reset();
+                    released = true;
+                }
+            }
+
+            if (released) {
+                std::erase(registry.rings, nullptr);
+            }
+
+            if (written) {
+                std::cout.flush();
+                std::cerr.flush();
+            }
+        }
+
+        // Taking the mutex orders the notification after the checks of the waiting threads
+        { std::lock_guard wakeLock { registry.wakeMutex }; }
+        registry.drained.notify_all();
+    }
+
+    // Called after a commit, only the first message since the last drain wakes the writer
+    void notifyWriter(Registry& registry)
+    {
+        if (!registry.pending.exchange(true, std::memory_order_acq_rel)) {
+            { std::lock_guard wakeLock { registry.wakeMutex }; }
+            registry.wake.notify_one();
+        }
+    }
+
+    void shutdown();
+
+    // Leaked so that threads still running at exit can log, the writer is stopped by an atexit handler
+    // and later messages are written synchronously
+    Registry& getRegistry()
+    {
+        static Registry* registry = []() {
+            Registry* created = new Registry;
+            created->writer = std::thread([created]() {
+                while (created->running.load(std::memory_order_acquire)) {
+                    {
+                        std::unique_lock wakeLock { created->wakeMutex };
+                        created->wake.wait(wakeLock, [created]() {
+                            return created->pending.load(std::memory_order_acquire) || !created->running.load(std::memory_order_acquire);
+                        });
+                    }
+
+                    // Reset before draining, a message committed meanwhile wakes the writer again
+                    created->pending.exchange(false, std::memory_order_acq_rel);
+                    drainAll(*created);
+                }
+            });
+            std::atexit(shutdown);
+            return created;
+        }();
+        return *registry;
+    }
+
+    void shutdown()
+    {
+        Registry& registry = getRegistry();
+        {
+            std::lock_guard wakeLock { registry.wakeMutex };
+            registry.running.store(false, std::memory_order_release);
+        }
+        registry.wake.notify_one();
+        registry.drained.notify_all();
+        registry.writer.join();
+
+        drainAll(registry);
+    }
+
+    // Constructing a stream costs more than formatting most messages
+    struct ThreadStream {
+        std::ostream stream { nullptr };
+        bool inUse = false;
+    };
+
+    // Leaked like the rings, static destructors still log after the thread locals of the main thread are destroyed
+    ThreadStream& getThreadStream()
+    {
+        thread_local ThreadStream* stream = new ThreadStream;
+        return *stream;
+    }
+
+    // Plain pointers, still usable by the static destructors running after the thread locals of the main thread are destroyed
+    thread_local ThreadRing* threadRing = nullptr;
+    thread_local bool threadExiting = false;
+
+    struct ThreadRingRelease {
+        ~ThreadRingRelease()
+        {
+            threadExiting = true;
+            threadRing->exited.store(true, std::memory_order_release);
+            threadRing = nullptr;
+        }
+    };
+
+    ThreadBuffer& getThreadBuffer()
+    {
+        if (threadRing == nullptr) {
+            Registry& registry = getRegistry();
+            {
+                std::lock_guard lock { registry.mutex };
+                threadRing = registry.rings.emplace_back(std::make_unique<ThreadRing>()).get();
+            }
+
+            // Messages logged by an exiting thread after the release get a ring that is never released
+            if (!threadExiting) {
+                thread_local ThreadRingRelease release;
+                static_cast<void>(release);
+            }
+        }
+        return threadRing->buffer;
+    }
+
+}
+
+Message::Message(const char* prefix, bool error, const char* file, uint32_t line)
+    : _prefix { prefix }
+    , _file { file }
+    , _line { line }
+    , _error { error }
+    , _buffer { _text, MaxMessageLength }
+{
+    ThreadStream& threadStream = getThreadStream();
+    if (threadStream.inUse) {
+        _stream = &_nestedStream.emplace(&_buffer);
+        return;
+    }
+
+    // rdbuf also clears the error state
+    threadStream.inUse = true;
+    _stream = &threadStream.stream;
+    _stream->rdbuf(&_buffer);
+    _stream->flags(std::ios_base::dec | std::ios_base::skipws);
+    _stream->precision(6);
+    _stream->width(0);
+    _stream->fill(' ');
+}
+
+Message::~Message()
+{
+    if (!_nestedStream) {
+        getThreadStream().inUse = false;
+    }
+
+    Registry& registry = getRegistry();
+    ThreadBuffer& buffer = getThreadBuffer();
+
+    // Blocking, only reached by bursts of more than MessageRingCapacity messages before the writer caught up
+    Record* record = buffer.tryAcquire();
+    while (record == nullptr) {
+        if (!registry.running.load(std::memory_order_acquire)) {
+            drainAll(registry);
+            record = buffer.tryAcquire();
+            continue;
+        }
+
+        notifyWriter(registry);
+
+        std::unique_lock wakeLock { registry.wakeMutex };
+        registry.drained.wait(wakeLock, [&]() {
+            record = buffer.tryAcquire();
+            return record != nullptr || !registry.running.load(std::memory_order_acquire);
+        });
+    }
+
+    record->prefix = _prefix;
+    record->file = _file;
+    record->line = _line;
+    record->length = static_cast<uint16_t>(_buffer.getLength());
+    record->error = _error;
+    std::memcpy(record->text, _text, record->length);
+    buffer.commit();
+
+    // Past the writer shutdown, nothing else would write it
+    if (!registry.running.load(std::memory_order_acquire)) {
+        drainAll(registry);
+    } else {
+        notifyWriter(registry);
+    }
+}
+
+void flush()
+{
+    drainAll(getRegistry());
+}
+
+} // namespace TBD::Log
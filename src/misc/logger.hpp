@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+
+// Included by misc/utils.hpp, use the TBD_LOG, TBD_WARN, TBD_ERROR, TBD_DEBUG and TBD_ABORT macros
+namespace TBD::Log {
+
+// Longer messages are truncated
+inline constexpr size_t MaxMessageLength = 472;
+
+// Messages a thread can queue before blocking, the writer is woken by the first message queued since its last drain
+inline constexpr uint64_t MessageRingCapacity = 256;
+
+// Fixed size stream buffer, formatting a message never allocates
+class MessageBuffer : public std::streambuf {
+public:
+    inline MessageBuffer(char* data, size_t size) { setp(data, data + size); }
+
+    [[nodiscard]] inline size_t getLength() const { return static_cast<size_t>(pptr() - pbase()); }
+
+protected:
+    // Characters past the end are dropped instead of failing the stream
+    inline int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+};
+
+// Formats one message on the stack and hands it to the per thread ring of the writer thread on destruction.
+// The destructor blocks while the ring is full, until the writer drained it, so bursts of more than
+// MessageRingCapacity messages wait on the console. The ring of a thread is released once it exited and was drained. The prefix and the file must be string literals, they are
+// written after the message was queued.
+// The stream of the thread is reused with its format flags reset, messages logged while formatting another one get their own
+class Message {
+public:
+    Message(const char* prefix, bool error, const char* file, uint32_t line);
+
+    ~Message();
+
+    Message(const Message&) = delete;
+    Message& operator=(const Message&) = delete;
+
+    [[nodiscard]] inline std::ostream& getStream() { return *_stream; }
+
+private:
+    const char* _prefix;
+    const char* _file;
+    uint32_t _line;
+    bool _error;
+
+    char _text[MaxMessageLength];
+    MessageBuffer _buffer;
+    std::ostream* _stream;
+    std::optional<std::ostream> _nestedStream;
+};
+
+// Synchronously writes every queued message, from any thread, before an abort
+void flush();
+
+} // namespace TBD::Log
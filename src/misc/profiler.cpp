@@ -0,0 +1,152 @@
+#include <misc/utils.hpp>
+
+#if TBD_PROFILE
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <misc/profiler.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace TBD::Profiler {
+
+namespace {
+
+    struct CollectedZone {
+        ZoneEvent event;
+        uint32_t threadId;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        std::unordered_map<uint32_t, std::string> threadNames;
+
+        // Drained from the thread buffers by collect, until the trace is written
+        std::vector<CollectedZone> zones;
+        const uint64_t startNs = now();
+    };
+
+    // Leaked so that threads still running at exit can record into it
+    Registry& getRegistry()
+    {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    // Created during static initialization rather than by the first zone, the trace starts with the process
+    [[maybe_unused]] const Registry& StaticRegistry = getRegistry();
+
+    void collectLocked(Registry& registry)
+    {
+        for (const auto& buffer : registry.buffers) {
+            buffer->drain([&](const ZoneEvent& event) { registry.zones.emplace_back(CollectedZone { event, buffer->getThreadId() }); });
+        }
+    }
+
+    void writeEscaped(std::ostream& stream, std::string_view string)
+    {
+        for (char c : string) {
+            if (c == '"' || c == '\\') {
+                stream << '\\';
+            }
+            stream << c;
+        }
+    }
+
+}
+
+ThreadBuffer::ThreadBuffer(uint32_t threadId)
+    : _threadId { threadId }
+{
+}
+
+ThreadBuffer* registerThread()
+{
+    Registry& registry = getRegistry();
+    std::lock_guard lock { registry.mutex };
+
+    const uint32_t threadId = static_cast<uint32_t>(registry.buffers.size());
+    return registry.buffers.emplace_back(std::make_unique<ThreadBuffer>(threadId)).get();
+}
+
+void setThreadName(std::string name)
+{
+    const uint32_t threadId = getThreadBuffer().getThreadId();
+
+    Registry& registry = getRegistry();
+    std::lock_guard lock { registry.mutex };
+    registry.threadNames[threadId] = std::move(name);
+}
+
+void collect()
+{
+    Registry& registry = getRegistry();
+    std::lock_guard lock { registry.mutex };
+    collectLocked(registry);
+}
+
+bool writeChromeTrace(const std::filesystem::path& path)
+{
+    std::ofstream file { path };
+    if (!file.is_open()) {
+        TBD_WARN("Failed to open the profiler trace \"" << path.string() << "\"");
+        return false;
+    }
+
+    Registry& registry = getRegistry();
+    std::lock_guard lock { registry.mutex };
+
+    // Complete events in microseconds since the registry creation
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separate = [&file, &first]() {
+        file << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (const auto& [threadId, name] : registry.threadNames) {
+        separate();
+        file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":\"";
+        writeEscaped(file, name);
+        file << "\"}}";
+    }
+
+    collectLocked(registry);
+    for (const CollectedZone& zone : registry.zones) {
+        // Zones opened by static initializers running before the registry's own start at 0
+        const uint64_t startNs = std::max(zone.event.startNs, registry.startNs);
+
+        separate();
+        file << "{\"ph\":\"X\",\"name\":\"";
+        writeEscaped(file, zone.event.name);
+        file << "\",\"pid\":1,\"tid\":" << zone.threadId
+             << ",\"ts\":" << double(startNs - registry.startNs) / 1e3
+             << ",\"dur\":" << double(zone.event.endNs - startNs) / 1e3 << "}";
+    }
+    const size_t eventCount = registry.zones.size();
+    registry.zones.clear();
+
+    uint64_t droppedCount = 0;
+    for (const auto& buffer : registry.buffers) {
+        droppedCount += buffer->getDroppedCount();
+    }
+
+    file << "\n]}\n";
+
+    TBD_LOG("Profiler trace with " << eventCount << " zones written to \"" << path.string() << "\"");
+    if (droppedCount != 0) {
+        TBD_WARN(droppedCount << " profiler zones were dropped by full thread buffers");
+    }
+
+    return file.good();
+}
+
+} // namespace TBD::Profiler
+
+#endif
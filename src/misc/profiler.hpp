@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <misc/spsc_ring.hpp>
+#include <string>
+
+// Only included by misc/utils.hpp when TBD_PROFILE is enabled, use the TBD_PROFILE_* macros
+namespace TBD::Profiler {
+
+[[nodiscard]] inline uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ZoneEvent {
+    // Static strings only, literals or __func__
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Zones of a thread, drained by collect. Zones recorded while the ring is full are dropped rather than blocking the thread
+class ThreadBuffer {
+public:
+    static constexpr uint64_t Capacity = 1 << 15;
+
+    ThreadBuffer(uint32_t threadId);
+
+    ThreadBuffer(const ThreadBuffer&) = delete;
+    ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+
+    inline void push(const ZoneEvent& event)
+    {
+        if (!_events.tryPush(event)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Collector side, calls write on every event pushed since the last drain
+    template <typename WriteFunction>
+    inline void drain(WriteFunction&& write) { _events.drain(write); }
+
+    [[nodiscard]] inline uint32_t getThreadId() const { return _threadId; }
+
+    [[nodiscard]] inline uint64_t getDroppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    const uint32_t _threadId;
+    SpscRing<ZoneEvent, Capacity> _events;
+    std::atomic<uint64_t> _dropped = 0;
+};
+
+// Registers the calling thread, the buffer outlives the thread so its zones can still be flushed
+[[nodiscard]] ThreadBuffer* registerThread();
+
+[[nodiscard]] inline ThreadBuffer& getThreadBuffer()
+{
+    thread_local ThreadBuffer* buffer = registerThread();
+    return *buffer;
+}
+
+// Shown instead of the thread id in the trace viewers
+void setThreadName(std::string name);
+
+class Zone {
+public:
+    inline Zone(const char* name)
+        : _name { name }
+        , _startNs { now() }
+    {
+    }
+
+    inline ~Zone() { getThreadBuffer().push(ZoneEvent { _name, _startNs, now() }); }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* _name;
+    uint64_t _startNs;
+};
+
+// Moves the zones of every thread buffer into a growing process wide list, called regularly so that the buffers
+// never fill up over long runs. The list grows until the trace is written
+void collect();
+
+// Writes the collected zones and those still in the thread buffers into a Chrome trace JSON file, readable by
+// chrome://tracing and Perfetto. Zones are only written once, successive calls produce the zones recorded in between
+bool writeChromeTrace(const std::filesystem::path& path);
+
+} // namespace TBD::Profiler
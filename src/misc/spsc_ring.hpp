@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace TBD {
+
+// Single producer single consumer ring of Capacity items, filled in place by its producer thread and drained by one
+// consumer at a time. What to do when it is full, drop or wait, is left to the producer
+template <typename T, uint64_t Capacity>
+class SpscRing {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "The ring capacity must be a power of two");
+
+public:
+    SpscRing()
+        : _items { std::make_unique<T[]>(Capacity) }
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side, the slot to fill before commit, nullptr when full
+    [[nodiscard]] inline T* tryAcquire()
+    {
+        // The tail is only reloaded when the ring looks full, keeping the consumer's cache line out of the common path
+        const uint64_t head = _head.load(std::memory_order_relaxed);
+        if (head - _cachedTail == Capacity) {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head - _cachedTail == Capacity) {
+                return nullptr;
+            }
+        }
+        return &_items[head & (Capacity - 1)];
+    }
+
+    inline void commit() { _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    [[nodiscard]] inline bool tryPush(const T& item)
+    {
+        T* slot = tryAcquire();
+        if (slot == nullptr) {
+            return false;
+        }
+
+        *slot = item;
+        commit();
+        return true;
+    }
+
+    // Consumer side, calls consume on every item committed since the last drain, false when there was none
+    template <typename ConsumeFunction>
+    bool drain(ConsumeFunction&& consume)
+    {
+        const uint64_t head = _head.load(std::memory_order_acquire);
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == head) {
+            return false;
+        }
+
+        for (; tail != head; ++tail) {
+            consume(_items[tail & (Capacity - 1)]);
+        }
+        _tail.store(tail, std::memory_order_release);
+        return true;
+    }
+
+private:
+    const std::unique_ptr<T[]> _items;
+
+    alignas(64) std::atomic<uint64_t> _head = 0;
+    uint64_t _cachedTail = 0;
+    alignas(64) std::atomic<uint64_t> _tail = 0;
+};
+
+} // namespace TBD
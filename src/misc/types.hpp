@@ -24,5 +24,6 @@ using Vec4i = glm::ivec4;
 using Vec2u = glm::uvec2;
 using Vec3u = glm::uvec3;
 using Vec4u = glm::uvec4;
+using Mat4 = glm::mat4;
 
 } // namespace TBD
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <misc/logger.hpp>
 #include <misc/types.hpp>
 
+#if TBD_PROFILE
+#include <misc/profiler.hpp>
+#endif
+
 namespace TBD {
 
 #define TBD_MIN_T(T) std::numeric_limits<T>::min()
@@ -11,22 +17,90 @@ namespace TBD {
 
 #define _TBD_ENDLOG " - " << __FILE__ << ":" << __LINE__ << "\033[0m" << std::endl
 
-#define TBD_LOG(msg) std::cout << "[LOG]: " << msg << _TBD_ENDLOG
-#define TBD_LOG_VK(msg) std::cout << "[VK LOG]: " << msg << _TBD_ENDLOG
-#define TBD_WARN(msg) std::cerr << "\033[93m[WARNING]: " << msg << _TBD_ENDLOG
-#define TBD_WARN_VK(msg) std::cerr << "\033[93m[VK WARNING]: " << msg << _TBD_ENDLOG
-#define TBD_ERROR(msg) std::cerr << "\033[31m[ERROR]: " << msg << _TBD_ENDLOG
-#define TBD_ERROR_VK(msg) std::cerr << "\033[31m[VK ERROR]: " << msg << _TBD_ENDLOG
+// Messages below it are compiled out: 0 debug, 1 log, 2 warning, 3 error. Aborts are always written
+#ifndef TBD_LOG_LEVEL
+#ifdef PROJECT_DEBUG
+#define TBD_LOG_LEVEL 0
+#else
+#define TBD_LOG_LEVEL 1
+#endif
+#endif
+
+// Formatted on the calling thread without allocating, written by the logger thread, see Log::Message
+#define _TBD_LOG_WRITE(prefix, error, msg)                                     \
+    do {                                                                       \
+        ::TBD::Log::Message _tbdMessage { prefix, error, __FILE__, __LINE__ }; \
+        _tbdMessage.getStream() << msg;                                        \
+    } while (false)
+#define _TBD_LOG_DISABLED \
+    do {                  \
+    } while (false)
+
+#if TBD_LOG_LEVEL <= 0
+#define TBD_DEBUG(msg) _TBD_LOG_WRITE("\033[96m[DEBUG]: ", false, msg)
+#define TBD_DEBUG_VK(msg) _TBD_LOG_WRITE("\033[96m[VK DEBUG]: ", false, msg)
+#else
+#define TBD_DEBUG(msg) _TBD_LOG_DISABLED
+#define TBD_DEBUG_VK(msg) _TBD_LOG_DISABLED
+#endif
+
+#if TBD_LOG_LEVEL <= 1
+#define TBD_LOG(msg) _TBD_LOG_WRITE("[LOG]: ", false, msg)
+#define TBD_LOG_VK(msg) _TBD_LOG_WRITE("[VK LOG]: ", false, msg)
+#else
+#define TBD_LOG(msg) _TBD_LOG_DISABLED
+#define TBD_LOG_VK(msg) _TBD_LOG_DISABLED
+#endif
 
-#define _TBD_FATAL(msg) std::cerr << "\033[31m[FATAL]: " << msg << _TBD_ENDLOG
+#if TBD_LOG_LEVEL <= 2
+#define TBD_WARN(msg) _TBD_LOG_WRITE("\033[93m[WARNING]: ", true, msg)
+#define TBD_WARN_VK(msg) _TBD_LOG_WRITE("\033[93m[VK WARNING]: ", true, msg)
+#else
+#define TBD_WARN(msg) _TBD_LOG_DISABLED
+#define TBD_WARN_VK(msg) _TBD_LOG_DISABLED
+#endif
+
+#if TBD_LOG_LEVEL <= 3
+#define TBD_ERROR(msg) _TBD_LOG_WRITE("\033[31m[ERROR]: ", true, msg)
+#define TBD_ERROR_VK(msg) _TBD_LOG_WRITE("\033[31m[VK ERROR]: ", true, msg)
+#else
+#define TBD_ERROR(msg) _TBD_LOG_DISABLED
+#define TBD_ERROR_VK(msg) _TBD_LOG_DISABLED
+#endif
+
+#define _TBD_CONCAT_IMPL(a, b) a##b
+#define _TBD_CONCAT(a, b) _TBD_CONCAT_IMPL(a, b)
+
+// CPU zones recorded to per thread rings and flushed with Profiler::writeChromeTrace, compiled out without TBD_PROFILE.
+// Names must be string literals
+#if TBD_PROFILE
+#define TBD_PROFILE_ZONE(name) const ::TBD::Profiler::Zone _TBD_CONCAT(_tbdProfileZone, __COUNTER__) { name }
+#define TBD_PROFILE_FUNCTION() TBD_PROFILE_ZONE(__func__)
+#define TBD_PROFILE_THREAD(name) ::TBD::Profiler::setThreadName(name)
+#else
+#define TBD_PROFILE_ZONE(name) static_cast<void>(0)
+#define TBD_PROFILE_FUNCTION() static_cast<void>(0)
+#define TBD_PROFILE_THREAD(name) static_cast<void>(0)
+#endif
+
+// Written synchronously after the queued messages, the process is about to end
+#define _TBD_FATAL(msg)  \
+    ::TBD::Log::flush(); \
+    std::cerr << "\033[31m[FATAL]: " << msg << _TBD_ENDLOG
 #define TBD_ABORT(reason)   \
-    _TBD_FATAL(reason); \
-    std::abort()
+    do {                    \
+        _TBD_FATAL(reason); \
+        std::abort();       \
+    } while (false)
 
-#define _TBD_FATAL_VK(msg) std::cerr << "\033[31m[VK FATAL]: " << msg << _TBD_ENDLOG
+#define _TBD_FATAL_VK(msg) \
+    ::TBD::Log::flush();   \
+    std::cerr << "\033[31m[VK FATAL]: " << msg << _TBD_ENDLOG
 #define TBD_ABORT_VK(reason)   \
-    _TBD_FATAL_VK(reason); \
-    std::abort()
+    do {                       \
+        _TBD_FATAL_VK(reason); \
+        std::abort();          \
+    } while (false)
 
 #define TBD_NO_COPY(T)    \
     T(const T&) = delete; \
@@ -37,9 +111,6 @@ namespace TBD {
 #define TBD_NO_COPY_MOVE(T) TBD_NO_COPY(T) TBD_NO_MOVE(T)
 
 #ifdef PROJECT_DEBUG
-#define TBD_DEBUG(msg) std::cout << "\033[96m[DEBUG]: " << msg << _TBD_ENDLOG
-#define TBD_DEBUG_VK(msg) std::cout << "\033[96m[VK DEBUG]: " << msg << _TBD_ENDLOG
-
 #define TBD_ASSERT(condition, msg) \
     if (!(condition)) {            \
         TBD_ABORT(msg);                \
@@ -52,9 +123,6 @@ namespace TBD {
 #define _TBD_NOP \
     if (false) { \
     }
-#define TBD_DEBUG(msg) _TBD_NOP
-#define TBD_DEBUG_VK(msg) _TBD_NOP
-
 #define TBD_ASSERT(condition, msg) _TBD_NOP
 #define TBD_ASSERT_VK(condition, msg) _TBD_NOP
 #endif
@@ -0,0 +1,62 @@
+#include "dynamic_resolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace TBD {
+
+namespace {
+
+    // Keeps some room for the CPU side and the frame to frame variance
+    constexpr float Headroom = 0.9f;
+
+    // Within the band the scale doesn't move, avoids oscillating around the target
+    constexpr float LowerBand = 0.8f;
+
+    // Dropping fast on load spikes, rising slowly to avoid oscillations
+    constexpr float MaxDecreaseStep = 0.85f;
+    constexpr float MaxIncreaseStep = 1.05f;
+
+    constexpr float Smoothing = 0.2f;
+
+}
+
+DynamicResolution::DynamicResolution(const DynamicResolutionConfig& config)
+    : _config { config }
+    , _scale { config.maxScale }
+{
+}
+
+float DynamicResolution::update(float gpuFrameMs, float renderedScale)
+{
+    if (!_config.enabled || gpuFrameMs <= 0.f) {
+        return _scale;
+    }
+
+    // Brought to the current scale, a single spike would otherwise lower the scale again for every frame in flight
+    // still rendered at the scale before the drop
+    gpuFrameMs *= (_scale * _scale) / (renderedScale * renderedScale);
+
+    _smoothedFrameMs = _smoothedFrameMs == 0.f ? gpuFrameMs : _smoothedFrameMs + Smoothing * (gpuFrameMs - _smoothedFrameMs);
+
+    // Spikes are reacted to immediately instead of waiting for the average to catch up
+    const float frameMs = std::max(_smoothedFrameMs, gpuFrameMs > _config.targetFrameMs ? gpuFrameMs : 0.f);
+
+    const float budgetMs = _config.targetFrameMs * Headroom;
+    if (frameMs <= budgetMs && frameMs >= budgetMs * LowerBand) {
+        return _scale;
+    }
+
+    // GPU time is assumed proportional to the pixel count, so to the square of the scale
+    const float step = std::clamp(std::sqrt(budgetMs / frameMs), MaxDecreaseStep, MaxIncreaseStep);
+    const float scale = std::clamp(_scale * step, _config.minScale, _config.maxScale);
+
+    if (scale != _scale) {
+        // The next measurements are at the new scale
+        _smoothedFrameMs *= (scale * scale) / (_scale * _scale);
+        _scale = scale;
+    }
+
+    return _scale;
+}
+
+} // namespace TBD
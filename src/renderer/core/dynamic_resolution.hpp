@@ -0,0 +1,29 @@
+#pragma once
+
+#include <general/config.hpp>
+#include <misc/utils.hpp>
+
+namespace TBD {
+
+// Picks the render resolution scale of the next frames from the measured GPU frame time
+class DynamicResolution {
+public:
+    DynamicResolution(const DynamicResolutionConfig& config);
+
+    // Returns the scale to render the next frame with. renderedScale is the scale the measured frame was rendered at,
+    // frames complete a few frames after they are recorded and may predate the last scale changes
+    float update(float gpuFrameMs, float renderedScale);
+
+    [[nodiscard]] inline float getScale() const { return _scale; }
+
+    [[nodiscard]] inline float getMaxScale() const { return _config.maxScale; }
+
+private:
+    DynamicResolutionConfig _config;
+
+    float _scale;
+
+    float _smoothedFrameMs = 0.f;
+};
+
+} // namespace TBD
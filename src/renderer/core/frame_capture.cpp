@@ -0,0 +1,136 @@
+#include "frame_capture.hpp"
+#include <cstdint>
+#include <fstream>
+#include <type_traits>
+
+namespace TBD {
+
+namespace {
+
+    template <typename T>
+    void write(std::ostream& stream, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    [[nodiscard]] bool read(std::istream& stream, T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    void writeBytes(std::ostream& stream, const void* data, uint64_t size)
+    {
+        write(stream, size);
+        stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    // Bounded by the file size, a corrupted length can't allocate more than what is left to read
+    template <typename Container>
+    [[nodiscard]] bool readBytes(std::istream& stream, uint64_t remaining, Container& bytes)
+    {
+        uint64_t size;
+        if (!read(stream, size) || size > remaining) {
+            return false;
+        }
+
+        bytes.resize(size);
+        return static_cast<bool>(stream.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size)));
+    }
+
+}
+
+bool FrameCapture::save(const std::filesystem::path& path) const
+{
+    std::ofstream file { path, std::ios::binary };
+    if (!file.is_open()) {
+        TBD_WARN("Failed to open the frame capture \"" << path.string() << "\"");
+        return false;
+    }
+
+    write(file, Magic);
+    write(file, Version);
+    writeBytes(file, deviceName.data(), deviceName.size());
+    write(file, frameId);
+    write(file, cpuFrameMs);
+    write(file, gpuFrameMs);
+
+    write(file, width);
+    write(file, height);
+    write(file, framesInFlight);
+    write(file, resolutionScale);
+    write(file, directOutput);
+    write(file, workload);
+
+    write(file, static_cast<uint32_t>(resources.size()));
+    for (const CapturedResource& resource : resources) {
+        // Field by field, the padding would make captures of the same frame differ
+        write(file, resource.type);
+        write(file, resource.category);
+        write(file, resource.format);
+        write(file, resource.usage);
+        write(file, resource.width);
+        write(file, resource.height);
+    }
+
+    write(file, static_cast<uint32_t>(uploads.size()));
+    for (const CapturedUpload& upload : uploads) {
+        write(file, upload.resourceId);
+        writeBytes(file, upload.data.data(), upload.data.size());
+    }
+
+    TBD_LOG("Frame " << frameId << " captured to \"" << path.string() << "\"");
+    return file.good();
+}
+
+bool FrameCapture::load(const std::filesystem::path& path)
+{
+    std::error_code error;
+    const uint64_t fileSize = std::filesystem::file_size(path, error);
+
+    std::ifstream file { path, std::ios::binary };
+    if (error || !file.is_open()) {
+        TBD_WARN("Failed to open the frame capture \"" << path.string() << "\"");
+        return false;
+    }
+
+    uint32_t magic;
+    uint32_t version;
+    if (!read(file, magic) || magic != Magic || !read(file, version) || version != Version) {
+        TBD_WARN("\"" << path.string() << "\" is not a version " << Version << " frame capture");
+        return false;
+    }
+
+    uint32_t resourceCount;
+    bool valid = readBytes(file, fileSize, deviceName) && read(file, frameId) && read(file, cpuFrameMs) && read(file, gpuFrameMs)
+        && read(file, width) && read(file, height) && read(file, framesInFlight) && read(file, resolutionScale) && read(file, directOutput)
+        && read(file, workload) && read(file, resourceCount) && resourceCount <= fileSize;
+
+    if (valid) {
+        resources.resize(resourceCount);
+        for (CapturedResource& resource : resources) {
+            valid = valid && read(file, resource.type) && read(file, resource.category) && read(file, resource.format) && read(file, resource.usage)
+                && read(file, resource.width) && read(file, resource.height);
+        }
+    }
+
+    uint32_t uploadCount;
+    valid = valid && read(file, uploadCount) && uploadCount <= fileSize;
+    if (valid) {
+        uploads.resize(uploadCount);
+        for (CapturedUpload& upload : uploads) {
+            valid = valid && read(file, upload.resourceId) && upload.resourceId < resources.size() && readBytes(file, fileSize, upload.data);
+        }
+    }
+
+    if (!valid) {
+        TBD_WARN("The frame capture \"" << path.string() << "\" is truncated or corrupted");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace TBD
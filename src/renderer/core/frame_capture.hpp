@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <general/config.hpp>
+#include <misc/utils.hpp>
+#include <string>
+#include <vector>
+
+namespace TBD {
+
+// Backend format, usage and memory category values, kept opaque so that captures don't depend on the RHI headers
+struct CapturedResource {
+    enum class Type : uint8_t {
+        Texture,
+        Buffer
+    };
+
+    Type type = Type::Texture;
+    uint8_t category = 0;
+    uint32_t format = 0;
+    uint32_t usage = 0;
+
+    // Size in bytes for buffers
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+struct CapturedUpload {
+    // Index in FrameCapture::resources
+    uint32_t resourceId = 0;
+    std::vector<uint8_t> data;
+};
+
+// Everything a frame depends on, replayed headless by TBD_replay. The RenderingDAG has no commands yet, the frame
+// is described by the renderer configuration, the resources it created and the data uploaded to them
+struct FrameCapture {
+    static constexpr uint32_t Magic = 0x43444254; // "TBDC"
+    static constexpr uint32_t Version = 1;
+
+    // Informative, replays run on any device
+    std::string deviceName;
+    uint32_t frameId = 0;
+    float cpuFrameMs = 0.f;
+    float gpuFrameMs = 0.f;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t framesInFlight = 0;
+    float resolutionScale = 1.f;
+    bool directOutput = false;
+    RendererWorkload workload;
+
+    std::vector<CapturedResource> resources;
+    std::vector<CapturedUpload> uploads;
+
+    // Native endianness, captures are replayed on the same kind of machine
+    bool save(const std::filesystem::path& path) const;
+
+    bool load(const std::filesystem::path& path);
+};
+
+} // namespace TBD
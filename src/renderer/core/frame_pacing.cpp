@@ -0,0 +1,175 @@
+#include "frame_pacing.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace TBD {
+
+namespace {
+
+    // Below that share of the frame spent waiting, the CPU is the limit
+    constexpr float CpuBoundWaitRatio = 0.1f;
+
+    // Above that share of the frame the GPU was busy, waiting on it makes the frame GPU bound
+    constexpr float GpuBoundBusyRatio = 0.85f;
+
+    float getMetric(const FrameTimings& timings, FrameMetric metric)
+    {
+        switch (metric) {
+        case FrameMetric::Frame:
+            return timings.frameMs;
+        case FrameMetric::Record:
+            return timings.recordMs;
+        case FrameMetric::FenceWait:
+            return timings.fenceWaitMs;
+        case FrameMetric::AcquireWait:
+            return timings.acquireWaitMs;
+        case FrameMetric::Submit:
+            return timings.submitMs;
+        case FrameMetric::Present:
+            return timings.presentMs;
+        case FrameMetric::PresentWait:
+            return timings.presentWaitMs;
+        case FrameMetric::Gpu:
+            return timings.gpuMs;
+        default:
+            return 0.f;
+        }
+    }
+
+    size_t getBucket(float ms)
+    {
+        const auto& bounds = FrameHistogram::BucketBoundsMs;
+        return static_cast<size_t>(std::lower_bound(bounds.begin(), bounds.end(), ms) - bounds.begin());
+    }
+
+    FrameBound classify(const FrameTimings& timings, bool presents)
+    {
+        const float waitMs = timings.fenceWaitMs + timings.acquireWaitMs + timings.presentMs + timings.presentWaitMs;
+        if (waitMs < CpuBoundWaitRatio * timings.frameMs) {
+            return FrameBound::Cpu;
+        }
+
+        // A GPU mostly idle while the CPU waited on it was itself waiting for a swapchain image
+        if (!presents || timings.gpuMs >= GpuBoundBusyRatio * timings.frameMs) {
+            return FrameBound::Gpu;
+        }
+
+        return FrameBound::Present;
+    }
+
+}
+
+const char* toString(FrameBound bound)
+{
+    switch (bound) {
+    case FrameBound::Cpu:
+        return "CPU";
+    case FrameBound::Gpu:
+        return "GPU";
+    case FrameBound::Present:
+        return "Present";
+    default:
+        return "Unknown";
+    }
+}
+
+const char* toString(FrameMetric metric)
+{
+    switch (metric) {
+    case FrameMetric::Frame:
+        return "Frame";
+    case FrameMetric::Record:
+        return "Record";
+    case FrameMetric::FenceWait:
+        return "Fence wait";
+    case FrameMetric::AcquireWait:
+        return "Acquire wait";
+    case FrameMetric::Submit:
+        return "Submit";
+    case FrameMetric::Present:
+        return "Present";
+    case FrameMetric::PresentWait:
+        return "Present wait";
+    case FrameMetric::Gpu:
+        return "GPU";
+    default:
+        return "Unknown";
+    }
+}
+
+void FramePacing::record(FrameTimings timings, bool presents)
+{
+    timings.recordMs = std::max(0.f, timings.frameMs - timings.fenceWaitMs - timings.acquireWaitMs - timings.submitMs - timings.presentMs - timings.presentWaitMs);
+    timings.bound = classify(timings, presents);
+
+    FrameTimings& slot = _history[_nextFrame];
+    if (_frameCount == HistorySize) {
+        for (size_t metric = 0; metric < _histograms.size(); ++metric) {
+            --_histograms[metric].counts[getBucket(getMetric(slot, static_cast<FrameMetric>(metric)))];
+        }
+        --_boundCounts[static_cast<size_t>(slot.bound)];
+    } else {
+        ++_frameCount;
+    }
+
+    slot = timings;
+    for (size_t metric = 0; metric < _histograms.size(); ++metric) {
+        ++_histograms[metric].counts[getBucket(getMetric(slot, static_cast<FrameMetric>(metric)))];
+    }
+    ++_boundCounts[static_cast<size_t>(slot.bound)];
+
+    _nextFrame = (_nextFrame + 1) % HistorySize;
+}
+
+FramePacingStats FramePacing::getStats() const
+{
+    FramePacingStats stats { .frameCount = _frameCount, .boundCounts = _boundCounts };
+    if (_frameCount == 0) {
+        return stats;
+    }
+
+    std::vector<float> sorted(_frameCount);
+    for (size_t metric = 0; metric < stats.metrics.size(); ++metric) {
+        float sum = 0.f;
+        for (uint32_t i = 0; i < _frameCount; ++i) {
+            sorted[i] = getMetric(_history[i], static_cast<FrameMetric>(metric));
+            sum += sorted[i];
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](float p) { return sorted[static_cast<size_t>(p * float(sorted.size() - 1) + 0.5f)]; };
+        stats.metrics[metric] = FrameMetricStats {
+            .averageMs = sum / float(_frameCount),
+            .p50Ms = percentile(0.5f),
+            .p95Ms = percentile(0.95f),
+            .p99Ms = percentile(0.99f),
+            .maxMs = sorted.back()
+        };
+    }
+
+    return stats;
+}
+
+void FramePacing::logStats() const
+{
+    const FramePacingStats stats = getStats();
+    if (stats.frameCount == 0) {
+        return;
+    }
+
+    auto share = [&stats](FrameBound bound) { return 100.f * float(stats.boundCounts[static_cast<size_t>(bound)]) / float(stats.frameCount); };
+    TBD_LOG("Frame pacing over the last " << stats.frameCount << " frames: " << share(FrameBound::Cpu) << "% CPU bound, "
+                                          << share(FrameBound::Gpu) << "% GPU bound, " << share(FrameBound::Present) << "% present bound");
+
+    for (size_t metric = 0; metric < stats.metrics.size(); ++metric) {
+        const FrameMetricStats& metricStats = stats.metrics[metric];
+        if (metricStats.maxMs == 0.f) {
+            continue;
+        }
+
+        TBD_LOG("  " << toString(static_cast<FrameMetric>(metric)) << ": " << metricStats.averageMs << "ms average, " << metricStats.p50Ms << "ms p50, "
+                     << metricStats.p95Ms << "ms p95, " << metricStats.p99Ms << "ms p99, " << metricStats.maxMs << "ms max");
+    }
+}
+
+} // namespace TBD
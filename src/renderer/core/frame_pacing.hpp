@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <misc/utils.hpp>
+
+namespace TBD {
+
+// What limited a frame, from where the CPU waited and how busy the GPU was
+enum class FrameBound : uint8_t {
+    Cpu, // The CPU barely waited, recording and submitting set the pace
+    Gpu, // The CPU waited for the GPU, which was busy for most of the frame
+    Present, // The CPU waited for the GPU or the swapchain while the GPU was mostly idle, vsync or the compositor
+    Count
+};
+
+[[nodiscard]] const char* toString(FrameBound bound);
+
+// CPU side of a frame, in milliseconds of the render call
+struct FrameTimings {
+    uint32_t frameId = 0;
+    float frameMs = 0.f;
+
+    // What remains once the waits, the submit and the present are removed
+    float recordMs = 0.f;
+
+    // Timeline wait for the frame that last used the frame in flight resources
+    float fenceWaitMs = 0.f;
+    float acquireWaitMs = 0.f;
+    float submitMs = 0.f;
+    float presentMs = 0.f;
+
+    // Low latency mode only, wait for the oldest frame in flight to be presented
+    float presentWaitMs = 0.f;
+
+    // GPU time of the last completed frame, framesInFlight frames older, 0 when unknown
+    float gpuMs = 0.f;
+
+    FrameBound bound = FrameBound::Cpu;
+};
+
+enum class FrameMetric : uint8_t {
+    Frame,
+    Record,
+    FenceWait,
+    AcquireWait,
+    Submit,
+    Present,
+    PresentWait,
+    Gpu,
+    Count
+};
+
+[[nodiscard]] const char* toString(FrameMetric metric);
+
+// Sample counts of a metric over the last FramePacing::HistorySize frames
+struct FrameHistogram {
+    // Upper bounds in milliseconds, the last bucket holds everything above the previous bound
+    static constexpr std::array<float, 12> BucketBoundsMs { 0.5f, 1.f, 2.f, 4.f, 8.f, 12.f, 16.7f, 25.f, 33.4f, 50.f, 100.f, TBD_MAX_T(float) };
+
+    std::array<uint32_t, BucketBoundsMs.size()> counts {};
+};
+
+struct FrameMetricStats {
+    float averageMs = 0.f;
+    float p50Ms = 0.f;
+    float p95Ms = 0.f;
+    float p99Ms = 0.f;
+    float maxMs = 0.f;
+};
+
+struct FramePacingStats {
+    uint32_t frameCount = 0;
+    std::array<uint32_t, static_cast<size_t>(FrameBound::Count)> boundCounts {};
+    std::array<FrameMetricStats, static_cast<size_t>(FrameMetric::Count)> metrics {};
+};
+
+// Rolling frame timings with their classification, the histograms are updated as frames are recorded
+class FramePacing {
+public:
+    static constexpr uint32_t HistorySize = 256;
+
+    // Classifies the frame, presentation waits are ignored without a swapchain
+    void record(FrameTimings timings, bool presents);
+
+    // Timings of the last recorded frame
+    [[nodiscard]] inline const FrameTimings& getLast() const { return _history[(_nextFrame + HistorySize - 1) % HistorySize]; }
+
+    [[nodiscard]] inline const FrameHistogram& getHistogram(FrameMetric metric) const { return _histograms[static_cast<size_t>(metric)]; }
+
+    // Frames classified as bound in the rolling window
+    [[nodiscard]] inline uint32_t getBoundCount(FrameBound bound) const { return _boundCounts[static_cast<size_t>(bound)]; }
+
+    [[nodiscard]] inline uint32_t getFrameCount() const { return _frameCount; }
+
+    // Sorts the history, meant for reports rather than every frame
+    [[nodiscard]] FramePacingStats getStats() const;
+
+    void logStats() const;
+
+private:
+    std::array<FrameTimings, HistorySize> _history {};
+    uint32_t _nextFrame = 0;
+    uint32_t _frameCount = 0;
+
+    std::array<FrameHistogram, static_cast<size_t>(FrameMetric::Count)> _histograms {};
+    std::array<uint32_t, static_cast<size_t>(FrameBound::Count)> _boundCounts {};
+};
+
+} // namespace TBD
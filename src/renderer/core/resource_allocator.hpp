@@ -7,7 +7,7 @@ namespace TBD {
 
 template <UnmanagedResource T>
 class ResourceAllocator {
-    TBD_NO_COPY_MOVE(ResourceAllocator<T>)
+    TBD_NO_COPY_MOVE(ResourceAllocator)
 public:
     ResourceAllocator();
 
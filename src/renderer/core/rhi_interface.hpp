@@ -16,7 +16,7 @@ public:
 
     virtual ~IRHI() = default;
 
-    virtual void render(const RenderingDAG& dag) const = 0;
+    virtual void render(const RenderingDAG& dag) = 0;
 };
 
 template <typename T>
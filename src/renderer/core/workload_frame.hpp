@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <general/config.hpp>
+#include <span>
+
+namespace TBD {
+
+// Texels uploaded by the texture streaming of the workload. Noise rather than a constant, like decoded texels
+inline void fillStreamingNoise(std::span<uint32_t> texels)
+{
+    for (size_t i = 0; i < texels.size(); ++i) {
+        texels[i] = static_cast<uint32_t>(i * 2654435761u);
+    }
+}
+
+// The frame every backend records for a RendererWorkload, so that the null frames match the Vulkan ones. The backends
+// provide the passes with their barriers: the gradient pass writes the render target in the general layout, the
+// triangle pass renders to it and the blit copies it to the output image, skipped with direct output
+template <typename StreamFunction, typename GradientFunction, typename TriangleFunction, typename BlitFunction>
+void recordWorkloadFrame(const RendererWorkload& workload, bool directOutput, StreamFunction&& streamTexture, GradientFunction&& gradientPass,
+    TriangleFunction&& trianglePass, BlitFunction&& blitPass)
+{
+    if (workload.streamedTextureSize != 0) {
+        streamTexture();
+    }
+
+    gradientPass();
+    trianglePass();
+
+    if (!directOutput) {
+        blitPass();
+    }
+}
+
+// Dispatches of the gradient pass, each one after the first waits for the storage writes of the previous one
+template <typename BarrierFunction, typename DispatchFunction>
+void recordWorkloadDispatches(const RendererWorkload& workload, BarrierFunction&& barrier, DispatchFunction&& dispatch)
+{
+    for (uint32_t i = 0; i < workload.dispatchCount; ++i) {
+        if (i != 0) {
+            barrier();
+        }
+        dispatch();
+    }
+}
+
+// Draws of the triangle pass, draw gets the index of the triangle in the grid
+template <typename DrawFunction>
+void recordWorkloadDraws(const RendererWorkload& workload, DrawFunction&& draw)
+{
+    for (uint32_t i = 0; i < workload.drawCount; ++i) {
+        draw(i);
+    }
+}
+
+} // namespace TBD
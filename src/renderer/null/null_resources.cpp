@@ -0,0 +1,73 @@
+#include "null_resources.hpp"
+
+namespace TBD {
+
+const char* toString(NullResourceState state)
+{
+    switch (state) {
+    case NullResourceState::Undefined:
+        return "Undefined";
+    case NullResourceState::General:
+        return "General";
+    case NullResourceState::ColorAttachment:
+        return "ColorAttachment";
+    case NullResourceState::TransferSrc:
+        return "TransferSrc";
+    case NullResourceState::TransferDst:
+        return "TransferDst";
+    case NullResourceState::ShaderRead:
+        return "ShaderRead";
+    case NullResourceState::Present:
+        return "Present";
+    default:
+        return "Unknown";
+    }
+}
+
+uint32_t getRequiredUsage(NullResourceState state)
+{
+    switch (state) {
+    case NullResourceState::Undefined:
+        return 0;
+    case NullResourceState::General:
+        return NullTextureUsageStorage;
+    case NullResourceState::ColorAttachment:
+        return NullTextureUsageColorAttachment;
+    case NullResourceState::TransferSrc:
+        return NullTextureUsageTransferSrc;
+    case NullResourceState::TransferDst:
+        return NullTextureUsageTransferDst;
+    case NullResourceState::ShaderRead:
+        return NullTextureUsageSampled;
+    case NullResourceState::Present:
+        return NullTextureUsagePresent;
+    default:
+        return 0;
+    }
+}
+
+NullTexture::NullTexture(uint32_t width, uint32_t height, uint32_t usage)
+    : _width { width }
+    , _height { height }
+    , _usage { usage }
+{
+    TBD_ASSERT(usage != 0, "Null texture created without usage");
+}
+
+void NullTexture::release(const IRHI&)
+{
+    _usage = 0;
+    _state = NullResourceState::Undefined;
+}
+
+NullBuffer::NullBuffer(uint32_t size)
+    : _data(size)
+{
+}
+
+void NullBuffer::release(const IRHI&)
+{
+    _data = {};
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <misc/utils.hpp>
+#include <renderer/core/rhi_interface.hpp>
+#include <vector>
+
+namespace TBD {
+
+// Stand-ins for the Vulkan image layouts, a texture is in exactly one of them between commands
+enum class NullResourceState : uint8_t {
+    Undefined,
+    General, // Storage writes
+    ColorAttachment,
+    TransferSrc,
+    TransferDst,
+    ShaderRead,
+    Present
+};
+
+[[nodiscard]] const char* toString(NullResourceState state);
+
+// Bit flags, each state but Undefined requires one of them
+enum NullTextureUsage : uint32_t {
+    NullTextureUsageStorage = 1 << 0,
+    NullTextureUsageColorAttachment = 1 << 1,
+    NullTextureUsageTransferSrc = 1 << 2,
+    NullTextureUsageTransferDst = 1 << 3,
+    NullTextureUsageSampled = 1 << 4,
+    NullTextureUsagePresent = 1 << 5
+};
+
+// Usage a texture needs to be transitioned to state, 0 for Undefined
+[[nodiscard]] uint32_t getRequiredUsage(NullResourceState state);
+
+class NullTexture {
+    TBD_NO_COPY(NullTexture)
+public:
+    NullTexture() = default;
+
+    NullTexture(uint32_t width, uint32_t height, uint32_t usage);
+
+    NullTexture(NullTexture&& other) = default;
+
+    NullTexture& operator=(NullTexture&& other) = default;
+
+    void release(const IRHI& rhi);
+
+    [[nodiscard]] inline uint32_t getWidth() const { return _width; }
+
+    [[nodiscard]] inline uint32_t getHeight() const { return _height; }
+
+    [[nodiscard]] inline uint32_t getUsage() const { return _usage; }
+
+    [[nodiscard]] inline bool isValid() const { return _usage != 0; }
+
+    // Tracked like VulkanTexture::_layout, set by the barriers the NullRHI records
+    [[nodiscard]] inline NullResourceState getState() const { return _state; }
+
+    inline void setState(NullResourceState state) { _state = state; }
+
+private:
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    uint32_t _usage = 0;
+    NullResourceState _state = NullResourceState::Undefined;
+};
+
+// Host memory, always mapped
+class NullBuffer {
+    TBD_NO_COPY(NullBuffer)
+public:
+    NullBuffer() = default;
+
+    explicit NullBuffer(uint32_t size);
+
+    NullBuffer(NullBuffer&& other) = default;
+
+    NullBuffer& operator=(NullBuffer&& other) = default;
+
+    void release(const IRHI& rhi);
+
+    [[nodiscard]] inline bool isValid() const { return !_data.empty(); }
+
+    [[nodiscard]] inline uint64_t getSize() const { return _data.size(); }
+
+    [[nodiscard]] inline void* getMappedData() { return _data.data(); }
+
+private:
+    std::vector<uint8_t> _data;
+};
+
+}
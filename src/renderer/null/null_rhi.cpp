@@ -0,0 +1,243 @@
+#include "null_rhi.hpp"
+#include <chrono>
+#include <cstring>
+#include <renderer/core/workload_frame.hpp>
+
+namespace TBD {
+
+static_assert(RHI<NullRHI>, "NullRHI must satisfy the RHI concept");
+
+namespace {
+
+    constexpr uint32_t OutputImageUsage = NullTextureUsageColorAttachment | NullTextureUsageTransferDst | NullTextureUsageTransferSrc;
+    constexpr uint32_t RenderTargetUsage = NullTextureUsageColorAttachment | NullTextureUsageStorage | NullTextureUsageTransferDst | NullTextureUsageTransferSrc;
+    constexpr uint32_t StreamedTextureUsage = NullTextureUsageTransferDst | NullTextureUsageSampled;
+
+    // Same as TriangleConstants
+    constexpr uint32_t TriangleConstantsSize = 16 * sizeof(float);
+
+}
+
+NullRHI::NullRHI(const RendererConfig& config)
+    : _framesInFlight { config.framesInFlight }
+    , _directOutput { config.directOutput }
+    , _workload { config.workload }
+{
+    TBD_ASSERT(_framesInFlight >= RendererConfig::MinFramesInFlight && _framesInFlight <= RendererConfig::MaxFramesInFlight, "Invalid frames in flight count");
+
+    if (config.dynamicResolution.enabled) {
+        TBD_WARN("Dynamic resolution is ignored by the null RHI, rendering at " << config.width << "x" << config.height);
+    }
+
+    // Direct output dispatches straight to the output images
+    const uint32_t outputUsage = _directOutput ? OutputImageUsage | NullTextureUsageStorage : OutputImageUsage;
+    for (uint32_t i = 0; i < _framesInFlight; ++i) {
+        _outputImages.push_back(createTexture(config.width, config.height, outputUsage));
+        if (!_directOutput) {
+            _renderTargets.push_back(createTexture(config.width, config.height, RenderTargetUsage));
+        }
+    }
+
+    if (const uint32_t size = _workload.streamedTextureSize; size != 0) {
+        _streamedTexture = createTexture(size, size, StreamedTextureUsage);
+
+        _streamingSource.resize(size_t(size) * size);
+        fillStreamingNoise(_streamingSource);
+
+        for (uint32_t i = 0; i < _framesInFlight; ++i) {
+            _streamingBuffers.push_back(createBuffer(static_cast<uint32_t>(_streamingSource.size() * sizeof(uint32_t))));
+        }
+    }
+
+    // The Vulkan frame records a handful of commands per draw and dispatch
+    _commands.reserve(16 + 2 * size_t(_workload.drawCount) + 2 * size_t(_workload.dispatchCount));
+
+    TBD_LOG("Null RHI with " << _framesInFlight << " frames in flight at " << config.width << "x" << config.height);
+}
+
+NullRHI::~NullRHI()
+{
+    if (_stats.validationErrorCount != 0) {
+        TBD_WARN("Null RHI: " << _stats.validationErrorCount << " validation errors over " << _stats.frameCount << " frames");
+    }
+
+    _framePacing.logStats();
+
+    _textures.clear(*this);
+    _buffers.clear(*this);
+}
+
+RID NullRHI::createTexture(uint32_t width, uint32_t height, uint32_t usage)
+{
+    return _textures.allocate(width, height, usage);
+}
+
+RID NullRHI::createBuffer(uint32_t size)
+{
+    return _buffers.allocate(size);
+}
+
+bool NullRHI::reportError()
+{
+    return _stats.validationErrorCount++ < MaxReportedErrors;
+}
+
+void NullRHI::validateTexture(RID texture, NullResourceState expected, const char* command)
+{
+    const NullTexture& resource = _textures.getResource(texture);
+    if (!resource.isValid()) {
+        if (reportError()) {
+            TBD_WARN("Null RHI: " << command << " uses the released texture " << texture);
+        }
+    } else if (resource.getState() != expected && reportError()) {
+        TBD_WARN("Null RHI: " << command << " expects texture " << texture << " in the " << toString(expected) << " state, found "
+                              << toString(resource.getState()));
+    }
+}
+
+void NullRHI::insertBarrier(RID texture, NullResourceState state)
+{
+    NullTexture& resource = _textures.getResource(texture);
+
+    if (_rendering && reportError()) {
+        TBD_WARN("Null RHI: barrier on texture " << texture << " inside a rendering scope");
+    }
+    if ((resource.getUsage() & getRequiredUsage(state)) != getRequiredUsage(state) && reportError()) {
+        TBD_WARN("Null RHI: texture " << texture << " transitioned to the " << toString(state) << " state without the matching usage");
+    }
+
+    // Barriers to the same state are kept, they order the accesses like the Vulkan memory barriers between dispatches
+    _commands.emplace_back(NullCommand { .type = NullCommandType::Barrier, .state = state, .resource = texture });
+    resource.setState(state);
+}
+
+void NullRHI::copyBufferToTexture(RID buffer, RID texture)
+{
+    if (!_buffers.getResource(buffer).isValid() && reportError()) {
+        TBD_WARN("Null RHI: copy from the released buffer " << buffer);
+    }
+    validateTexture(texture, NullResourceState::TransferDst, "Buffer to texture copy");
+
+    _commands.emplace_back(NullCommand { .type = NullCommandType::CopyBufferToTexture, .resource = buffer, .destination = texture });
+}
+
+void NullRHI::dispatch(RID target, uint32_t x, uint32_t y, uint32_t z)
+{
+    if (_rendering && reportError()) {
+        TBD_WARN("Null RHI: dispatch inside a rendering scope");
+    }
+    validateTexture(target, NullResourceState::General, "Dispatch");
+
+    _commands.emplace_back(NullCommand { .type = NullCommandType::Dispatch, .resource = target, .x = x, .y = y, .z = z });
+}
+
+void NullRHI::beginRendering(RID target)
+{
+    if (_rendering && reportError()) {
+        TBD_WARN("Null RHI: nested rendering scope");
+    }
+    validateTexture(target, NullResourceState::ColorAttachment, "Begin rendering");
+
+    _commands.emplace_back(NullCommand { .type = NullCommandType::BeginRendering, .resource = target });
+    _rendering = true;
+}
+
+void NullRHI::pushConstants(uint32_t size)
+{
+    _commands.emplace_back(NullCommand { .type = NullCommandType::PushConstants, .x = size });
+}
+
+void NullRHI::draw(uint32_t vertexCount)
+{
+    if (!_rendering && reportError()) {
+        TBD_WARN("Null RHI: draw outside of a rendering scope");
+    }
+
+    _commands.emplace_back(NullCommand { .type = NullCommandType::Draw, .x = vertexCount });
+}
+
+void NullRHI::endRendering()
+{
+    if (!_rendering && reportError()) {
+        TBD_WARN("Null RHI: end of a rendering scope that wasn't begun");
+    }
+
+    _commands.emplace_back(NullCommand { .type = NullCommandType::EndRendering });
+    _rendering = false;
+}
+
+void NullRHI::blit(RID src, RID dst)
+{
+    if (_rendering && reportError()) {
+        TBD_WARN("Null RHI: blit inside a rendering scope");
+    }
+    validateTexture(src, NullResourceState::TransferSrc, "Blit source");
+    validateTexture(dst, NullResourceState::TransferDst, "Blit destination");
+
+    _commands.emplace_back(NullCommand { .type = NullCommandType::Blit, .resource = src, .destination = dst });
+}
+
+void NullRHI::render(const RenderingDAG& rdag)
+{
+    TBD_PROFILE_ZONE("Null render");
+    const auto frameStart = std::chrono::steady_clock::now();
+
+    const uint32_t frameInFlightId = _frameId % _framesInFlight;
+    _commands.clear();
+
+    rdag.render(this);
+
+    const RID output = _outputImages[frameInFlightId];
+    const RID renderTarget = _directOutput ? output : _renderTargets[frameInFlightId];
+    const NullTexture& target = _textures.getResource(renderTarget);
+
+    // Same frame as VulkanRHI::render in headless mode
+    recordWorkloadFrame(
+        _workload,
+        _directOutput,
+        [&]() { streamTexture(frameInFlightId); },
+        [&]() {
+            insertBarrier(renderTarget, NullResourceState::General);
+            recordWorkloadDispatches(
+                _workload,
+                [&]() { insertBarrier(renderTarget, NullResourceState::General); },
+                [&]() { dispatch(renderTarget, target.getWidth(), target.getHeight(), 1); });
+        },
+        [&]() {
+            insertBarrier(renderTarget, NullResourceState::ColorAttachment);
+            beginRendering(renderTarget);
+            recordWorkloadDraws(_workload, [&](uint32_t) {
+                pushConstants(TriangleConstantsSize);
+                draw(3);
+            });
+            endRendering();
+        },
+        [&]() {
+            insertBarrier(renderTarget, NullResourceState::TransferSrc);
+            insertBarrier(output, NullResourceState::TransferDst);
+            blit(renderTarget, output);
+        });
+
+    const float frameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+    _framePacing.record(FrameTimings { .frameId = _frameId, .frameMs = frameMs, .recordMs = frameMs }, false);
+
+    _stats.frameCount++;
+    _stats.commandCount = static_cast<uint32_t>(_commands.size());
+    _stats.totalCommandCount += _commands.size();
+
+    ++_frameId;
+}
+
+void NullRHI::streamTexture(uint32_t frameInFlightId)
+{
+    TBD_PROFILE_FUNCTION();
+
+    NullBuffer& staging = _buffers.getResource(_streamingBuffers[frameInFlightId]);
+    std::memcpy(staging.getMappedData(), _streamingSource.data(), _streamingSource.size() * sizeof(uint32_t));
+
+    insertBarrier(_streamedTexture, NullResourceState::TransferDst);
+    copyBufferToTexture(_streamingBuffers[frameInFlightId], _streamedTexture);
+    insertBarrier(_streamedTexture, NullResourceState::ShaderRead);
+}
+
+}
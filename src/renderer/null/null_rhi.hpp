@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <general/config.hpp>
+#include <misc/types.hpp>
+#include <misc/utils.hpp>
+#include <renderer/core/frame_pacing.hpp>
+#include <renderer/core/resource_allocator.hpp>
+#include <renderer/core/rhi_interface.hpp>
+#include <renderer/null/null_resources.hpp>
+#include <renderer/rendering_dag/rendering_dag.hpp>
+#include <vector>
+
+namespace TBD {
+
+enum class NullCommandType : uint8_t {
+    Barrier,
+    CopyBufferToTexture,
+    Dispatch,
+    BeginRendering,
+    PushConstants,
+    Draw,
+    EndRendering,
+    Blit
+};
+
+struct NullCommand {
+    NullCommandType type;
+
+    // New state of barriers
+    NullResourceState state = NullResourceState::Undefined;
+
+    // Texture, or the source buffer of copies
+    RID resource = InvalidRID;
+
+    // Destination texture of copies and blits
+    RID destination = InvalidRID;
+
+    // Invocations of dispatches, vertex count of draws, push constant bytes
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t z = 0;
+};
+
+struct NullRHIStats {
+    uint32_t frameCount = 0;
+
+    // Of the last frame
+    uint32_t commandCount = 0;
+    uint64_t totalCommandCount = 0;
+
+    // Since creation, only the first NullRHI::MaxReportedErrors are logged
+    uint32_t validationErrorCount = 0;
+};
+
+// Backend without a device nor a driver, records the frames of VulkanRHI into memory and validates the resource states
+// and usages as the commands are recorded. Runs at full CPU speed on any machine, for benchmarks and tests of the CPU side
+class NullRHI : public IRHI {
+    TBD_NO_COPY_MOVE(NullRHI)
+public:
+    using Type = NullRHI;
+    using TextureType = NullTexture;
+    using BufferType = NullBuffer;
+
+    static constexpr uint32_t MaxReportedErrors = 16;
+
+public:
+    NullRHI() = delete;
+
+    // Always headless, dynamic resolution needs GPU times and is ignored
+    explicit NullRHI(const RendererConfig& config);
+
+    ~NullRHI();
+
+    [[nodiscard]] inline uint32_t getFramesInFlight() const { return _framesInFlight; }
+
+    inline NullTexture& getTexture(RID rid) { return _textures.getResource(rid); }
+
+    inline NullBuffer& getBuffer(RID rid) { return _buffers.getResource(rid); }
+
+    // Usage is a combination of NullTextureUsage flags
+    [[nodiscard]] RID createTexture(uint32_t width, uint32_t height, uint32_t usage);
+
+    [[nodiscard]] RID createBuffer(uint32_t size);
+
+    // Commands of the current frame, validated against the tracked states
+    void insertBarrier(RID texture, NullResourceState state);
+
+    void copyBufferToTexture(RID buffer, RID texture);
+
+    // Writes the storage texture, in invocations
+    void dispatch(RID target, uint32_t x, uint32_t y, uint32_t z);
+
+    void beginRendering(RID target);
+
+    void pushConstants(uint32_t size);
+
+    void draw(uint32_t vertexCount);
+
+    void endRendering();
+
+    void blit(RID src, RID dst);
+
+    // Commands of the last rendered frame
+    [[nodiscard]] inline const std::vector<NullCommand>& getCommands() const { return _commands; }
+
+    [[nodiscard]] inline const NullRHIStats& getStats() const { return _stats; }
+
+    // Frame and record times are the same, nothing is waited for
+    [[nodiscard]] inline const FramePacing& getFramePacing() const { return _framePacing; }
+
+    virtual void render(const RenderingDAG& rdag) override;
+
+private:
+    // Counts the error, true while it should still be logged
+    [[nodiscard]] bool reportError();
+
+    void validateTexture(RID texture, NullResourceState expected, const char* command);
+
+    void streamTexture(uint32_t frameInFlightId);
+
+    uint32_t _framesInFlight;
+    uint32_t _frameId = 1;
+    bool _directOutput;
+    RendererWorkload _workload;
+
+    ResourceAllocator<NullTexture> _textures;
+    ResourceAllocator<NullBuffer> _buffers;
+
+    // Headless output images, one per frame in flight, and the intermediates rendered to unless direct output is used
+    std::vector<RID> _outputImages;
+    std::vector<RID> _renderTargets;
+
+    std::vector<uint32_t> _streamingSource;
+    std::vector<RID> _streamingBuffers;
+    RID _streamedTexture = InvalidRID;
+
+    std::vector<NullCommand> _commands;
+    bool _rendering = false;
+
+    NullRHIStats _stats;
+    FramePacing _framePacing;
+};
+
+}
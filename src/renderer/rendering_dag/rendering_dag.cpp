@@ -2,13 +2,6 @@
 
 namespace TBD {
 
-template <RHI RHI>
-void RenderingDAG::render(RHI* rhi) const
-{
-    // T::TextureType test;
-
-}
-
 void RenderingDAG::clear() {
     
 }
@@ -20,4 +20,11 @@ private:
     // std::vector<RenderingCommand*> _commands;
 };
 
+// In the header to be instantiated by every backend
+template <RHI RHI>
+void RenderingDAG::render([[maybe_unused]] RHI* rhi) const
+{
+    // T::TextureType test;
+}
+
 }
\ No newline at end of file
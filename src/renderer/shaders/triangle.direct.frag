@@ -0,0 +1,20 @@
+#version 460
+
+//triangle.frag rendering straight to a UNORM swapchain image, see VKUtils::selectSurfaceFormat
+
+//shader input
+layout (location = 0) in vec3 inColor;
+
+//output write
+layout (location = 0) out vec4 outFragColor;
+
+//the attachment can't have an sRGB format, encode what the blit to the sRGB swapchain does
+vec3 linearToSrgb(vec3 color)
+{
+	return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+void main() 
+{
+	outFragColor = vec4(linearToSrgb(inColor), 1.0f);
+}
@@ -2,6 +2,12 @@
 
 layout (location = 0) out vec3 outColor;
 
+//per draw parameters
+layout(push_constant) uniform Constants
+{
+    mat4 transform;
+} constants;
+
 void main() 
 {
 	//const array of positions for the triangle
@@ -19,6 +25,6 @@ void main()
 	);
 
 	//output the position of each vertex
-	gl_Position = vec4(positions[gl_VertexIndex], 1.0f);
+	gl_Position = constants.transform * vec4(positions[gl_VertexIndex], 1.0f);
 	outColor = colors[gl_VertexIndex];
 }
@@ -1,9 +1,10 @@
 #include "vulkan_buffer.hpp"
+#include <renderer/vulkan/vulkan_rhi.hpp>
 #include <vulkan/vulkan_core.h>
 
 namespace TBD {
 
-VulkanBuffer::VulkanBuffer(VmaAllocator allocator, uint32_t size, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage)
+VulkanBuffer::VulkanBuffer(VulkanRHI* rhi, uint32_t size, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, MemoryCategory category)
 {
     VkBufferCreateInfo bufferCreateInfo {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -16,9 +17,36 @@ VulkanBuffer::VulkanBuffer(VmaAllocator allocator, uint32_t size, VkBufferUsageF
         .usage = memoryUsage
     };
 
-    if (vmaCreateBuffer(allocator, &bufferCreateInfo, &allocationCreateInfo, &_buffer, &_allocation, &_allocationInfo) != VK_SUCCESS) {
+    if (vmaCreateBuffer(rhi->getAllocator(), &bufferCreateInfo, &allocationCreateInfo, &_buffer, &_allocation, &_allocationInfo) != VK_SUCCESS) {
         TBD_ABORT_VK("Vulkan buffer creation failed");
     }
+    rhi->getMemoryTracker().track(_allocation, category);
+}
+
+VulkanBuffer::VulkanBuffer(VulkanBuffer&& other)
+    : _buffer { other._buffer }
+    , _allocation { other._allocation }
+    , _allocationInfo { other._allocationInfo }
+{
+    other._buffer = nullptr;
+    other._allocation = nullptr;
+    other._allocationInfo = {};
+}
+
+VulkanBuffer::~VulkanBuffer()
+{
+    TBD_ASSERT(_buffer == nullptr, "Vulkan buffer was not cleaned up");
+}
+
+void VulkanBuffer::release(const IRHI& rhi)
+{
+    if (_buffer) {
+        const VulkanRHI& vrhi = static_cast<const VulkanRHI&>(rhi);
+        vrhi.getMemoryTracker().untrack(_allocation);
+        vmaDestroyBuffer(vrhi.getAllocator(), _buffer, _allocation);
+        _buffer = nullptr;
+        _allocation = nullptr;
+    }
 }
 
 }
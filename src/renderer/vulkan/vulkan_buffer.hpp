@@ -1,26 +1,44 @@
 #pragma once
 
+#include <cstdint>
 #include <misc/utils.hpp>
-#include <renderer/vulkan/vulkan_rhi.hpp>
+#include <renderer/core/rhi_interface.hpp>
+#include <renderer/vulkan/vulkan_memory_tracker.hpp>
+#include <vk_mem_alloc.h>
 #include <vulkan/vulkan_core.h>
 
 namespace TBD {
 
+class VulkanRHI;
+
 class VulkanBuffer {
     TBD_NO_COPY(VulkanBuffer)
 public:
     VulkanBuffer() = delete;
 
-    VulkanBuffer(VmaAllocator allocator, uint32_t size, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage);
+    VulkanBuffer(VulkanRHI* rhi, uint32_t size, VkBufferUsageFlags usageFlags, VmaMemoryUsage memoryUsage, MemoryCategory category);
+
+    VulkanBuffer(VulkanBuffer&& other);
+
+    ~VulkanBuffer();
 
     void release(const IRHI& rhi);
 
     [[nodiscard]] bool isValid() const { return _buffer != nullptr; }
 
+    [[nodiscard]] inline VkBuffer getVkBuffer() const { return _buffer; }
+
+    [[nodiscard]] inline VkDeviceSize getSize() const { return _allocationInfo.size; }
+
+    // Persistently mapped, nullptr for device local memory
+    [[nodiscard]] inline void* getMappedData() const { return _allocationInfo.pMappedData; }
+
+    [[nodiscard]] inline VmaAllocation getAllocation() const { return _allocation; }
+
 private:
-    VkBuffer _buffer;
+    VkBuffer _buffer = nullptr;
     VmaAllocation _allocation = nullptr;
     VmaAllocationInfo _allocationInfo {};
 };
 
-}
\ No newline at end of file
+}
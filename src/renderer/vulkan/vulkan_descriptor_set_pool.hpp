@@ -2,26 +2,39 @@
 
 #include "vulkan/vulkan_core.h"
 #include <cstdint>
-#include <initializer_list>
 #include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_shader_reflection.hpp>
+#include <span>
+#include <unordered_map>
+#include <vector>
 
 namespace TBD {
 
 class VulkanRHI;
 
-template <uint32_t MaxFramesInFlight>
+struct DescriptorSetPoolStats {
+    uint32_t allocatedSets = 0;
+    uint32_t maxSets = 0;
+};
+
 class VulkanDescriptorSetPool {
     TBD_NO_COPY_MOVE(VulkanDescriptorSetPool)
 public:
     VulkanDescriptorSetPool() = delete;
 
-    // Bindings are expected in order i.e. first descritor type for index 0, second for index 1, etc.
-    inline VulkanDescriptorSetPool(VkDevice device, VkShaderStageFlags stageFlags, std::initializer_list<VkDescriptorType> bindingTypes, uint32_t maxSets);
+    // Bindings come from the reflected shader tables, only set 0 is managed by the pool, maxSets is split between the frames in flight
+    inline VulkanDescriptorSetPool(VkDevice device, uint32_t framesInFlight, VkShaderStageFlags stageFlags, std::span<const ShaderBinding> bindings, uint32_t maxSets);
 
     [[nodiscard]] inline VkDescriptorSet getDescriptorSet(VkDevice device, uint32_t frameInFlightId);
 
+    // Out of the per frame rotation, for sets bound by prerecorded command buffers, valid until the pool is cleared.
+    // Allocated from their own descriptor pools, added as needed, so they never take from the budget of the frames
+    [[nodiscard]] inline VkDescriptorSet allocatePersistentDescriptorSet(VkDevice device);
+
     [[nodiscard]] inline VkDescriptorSetLayout getLayout() const;
 
+    [[nodiscard]] inline const DescriptorSetPoolStats& getStats() const { return _stats; }
+
     inline void bind(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout);
 
     inline void updateDescriptorSet(VkDevice device, VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, VkPipelineLayout layout, VkDescriptorImageInfo imageInfo);
@@ -31,45 +44,68 @@ public:
     inline void releasePool(VkDevice device);
 
 private:
-    void allocateSet(VkDevice device, uint32_t frameInFlightId);
+    // Sized for maxSets sets of the layout
+    [[nodiscard]] inline VkDescriptorPool createPool(VkDevice device, uint32_t maxSets) const;
+
+    [[nodiscard]] inline VkResult allocateFromPool(VkDevice device, VkDescriptorPool pool, VkDescriptorSet& set);
+
+    inline void allocateSet(VkDevice device, uint32_t frameInFlightId);
 
 private:
+    static constexpr uint32_t PersistentSetsPerPool = 16;
+
     VkDescriptorSetLayout _layout;
 
     VkShaderStageFlags _stageFlags;
 
+    // Descriptors of a single set
+    std::vector<VkDescriptorPoolSize> _setSizes;
+
     VkDescriptorPool _pool;
 
+    // The last one is allocated from, the others are full
+    std::vector<VkDescriptorPool> _persistentPools;
+
     using DescriptorSets = std::vector<VkDescriptorSet>;
-    std::array<DescriptorSets, MaxFramesInFlight> _descriptorSets;
+    std::vector<DescriptorSets> _descriptorSets;
 
     uint32_t _maxSets;
 
+    uint32_t _maxSetsPerFrame;
+
     uint32_t _lastFrameInFlightId = TBD_MAX_T(decltype(_lastFrameInFlightId));
 
     uint32_t _nextDescriptorId;
+
+    DescriptorSetPoolStats _stats;
 };
 
-template <uint32_t MaxFramesInFlight>
-inline VulkanDescriptorSetPool<MaxFramesInFlight>::VulkanDescriptorSetPool(VkDevice device, VkShaderStageFlags stageFlags, std::initializer_list<VkDescriptorType> bindingTypes, uint32_t maxSets)
+inline VulkanDescriptorSetPool::VulkanDescriptorSetPool(VkDevice device, uint32_t framesInFlight, VkShaderStageFlags stageFlags, std::span<const ShaderBinding> bindings, uint32_t maxSets)
     : _stageFlags { stageFlags }
+    , _descriptorSets(framesInFlight)
     , _maxSets { maxSets }
+    , _maxSetsPerFrame { maxSets / framesInFlight }
+    , _stats { .maxSets = maxSets }
 {
-    for (uint32_t i = 0; i < MaxFramesInFlight; ++i) {
-        _descriptorSets[i].reserve(_maxSets / MaxFramesInFlight);
+    TBD_ASSERT(framesInFlight != 0 && _maxSetsPerFrame != 0, "Descriptor set pool too small for the frames in flight");
+
+    for (DescriptorSets& sets : _descriptorSets) {
+        sets.reserve(_maxSetsPerFrame);
     }
 
     // TODO: write a custom linear allocator for these kind of small allocations
     std::vector<VkDescriptorSetLayoutBinding> descriptorBindings {};
-    descriptorBindings.reserve(bindingTypes.size());
+    descriptorBindings.reserve(bindings.size());
 
     std::unordered_map<VkDescriptorType, uint32_t> descriptorTypeCounts {};
-    descriptorTypeCounts.reserve(bindingTypes.size());
+    descriptorTypeCounts.reserve(bindings.size());
+
+    for (const ShaderBinding& binding : bindings) {
+        TBD_ASSERT(binding.set == 0, "Descriptor set pools only handle set 0");
+        TBD_ASSERT(binding.count != 0, "Runtime sized descriptor arrays are not supported");
 
-    uint32_t i = 0;
-    for (VkDescriptorType descriptorType : bindingTypes) {
-        descriptorBindings.emplace_back(VkDescriptorSetLayoutBinding { .binding = i++, .descriptorType = descriptorType, .descriptorCount = 1, .stageFlags = stageFlags });
-        ++descriptorTypeCounts[descriptorType];
+        descriptorBindings.emplace_back(VkDescriptorSetLayoutBinding { .binding = binding.binding, .descriptorType = binding.type, .descriptorCount = binding.count, .stageFlags = stageFlags });
+        descriptorTypeCounts[binding.type] += binding.count;
     }
 
     VkDescriptorSetLayoutCreateInfo layoutCreateInfo {
@@ -83,29 +119,56 @@ inline VulkanDescriptorSetPool<MaxFramesInFlight>::VulkanDescriptorSetPool(VkDev
         TBD_ABORT_VK("Failed to create Vulkan descritor set layout");
     }
 
-    std::vector<VkDescriptorPoolSize> poolSizes {};
-    poolSizes.reserve(descriptorTypeCounts.size());
-
+    _setSizes.reserve(descriptorTypeCounts.size());
     for (auto [descriptorType, count] : descriptorTypeCounts) {
-        poolSizes.emplace_back(VkDescriptorPoolSize { descriptorType, _maxSets * count });
+        _setSizes.emplace_back(VkDescriptorPoolSize { descriptorType, count });
+    }
+
+    _pool = createPool(device, _maxSets);
+}
+
+inline VkDescriptorPool VulkanDescriptorSetPool::createPool(VkDevice device, uint32_t maxSets) const
+{
+    std::vector<VkDescriptorPoolSize> poolSizes = _setSizes;
+    for (VkDescriptorPoolSize& poolSize : poolSizes) {
+        poolSize.descriptorCount *= maxSets;
     }
 
     VkDescriptorPoolCreateInfo poolCreateInfo {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .maxSets = _maxSets,
+        .maxSets = maxSets,
         .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
         .pPoolSizes = poolSizes.data()
     };
 
-    if (vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &_pool) != VK_SUCCESS) {
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS) {
         TBD_ABORT_VK("Failed to create Vulkan descriptor pool");
     }
+
+    return pool;
+}
+
+inline VkResult VulkanDescriptorSetPool::allocateFromPool(VkDevice device, VkDescriptorPool pool, VkDescriptorSet& set)
+{
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &_layout
+    };
+
+    const VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+    if (result == VK_SUCCESS) {
+        ++_stats.allocatedSets;
+    }
+
+    return result;
 }
 
-template <uint32_t MaxFramesInFlight>
-inline VkDescriptorSet VulkanDescriptorSetPool<MaxFramesInFlight>::getDescriptorSet(VkDevice device, uint32_t frameInFlightId)
+inline VkDescriptorSet VulkanDescriptorSetPool::getDescriptorSet(VkDevice device, uint32_t frameInFlightId)
 {
-    TBD_ASSERT(frameInFlightId < MaxFramesInFlight, "Requested out of bound descriptor set");
+    TBD_ASSERT(frameInFlightId < _descriptorSets.size(), "Requested out of bound descriptor set");
     std::vector<VkDescriptorSet>& _currentFramePool = _descriptorSets[frameInFlightId];
 
     if (_lastFrameInFlightId != frameInFlightId) {
@@ -114,7 +177,7 @@ inline VkDescriptorSet VulkanDescriptorSetPool<MaxFramesInFlight>::getDescriptor
     }
 
     if (_nextDescriptorId >= _currentFramePool.size()) {
-        if (_currentFramePool.size() == _maxSets / MaxFramesInFlight) {
+        if (_currentFramePool.size() == _maxSetsPerFrame) {
             return nullptr;
         }
 
@@ -124,20 +187,35 @@ inline VkDescriptorSet VulkanDescriptorSetPool<MaxFramesInFlight>::getDescriptor
     return _currentFramePool[_nextDescriptorId++ ];
 }
 
-template <uint32_t MaxFramesInFlight>
-inline VkDescriptorSetLayout VulkanDescriptorSetPool<MaxFramesInFlight>::getLayout() const
+inline VkDescriptorSet VulkanDescriptorSetPool::allocatePersistentDescriptorSet(VkDevice device)
+{
+    VkDescriptorSet set;
+    if (!_persistentPools.empty() && allocateFromPool(device, _persistentPools.back(), set) == VK_SUCCESS) {
+        return set;
+    }
+
+    // Out of pool memory or sets, only the new pool is allocated from now on
+    _persistentPools.emplace_back(createPool(device, PersistentSetsPerPool));
+    _stats.maxSets += PersistentSetsPerPool;
+
+    if (allocateFromPool(device, _persistentPools.back(), set) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to allocate Vulkan descriptor set");
+    }
+
+    return set;
+}
+
+inline VkDescriptorSetLayout VulkanDescriptorSetPool::getLayout() const
 {
     return _layout;
 }
 
-template <uint32_t MaxFramesInFlight>
-inline void VulkanDescriptorSetPool<MaxFramesInFlight>::bind(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout)
+inline void VulkanDescriptorSetPool::bind(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout)
 {
     vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 }
 
-template <uint32_t MaxFramesInFlight>
-inline void VulkanDescriptorSetPool<MaxFramesInFlight>::updateDescriptorSet(VkDevice device, VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, VkPipelineLayout layout, VkDescriptorImageInfo imageInfo)
+inline void VulkanDescriptorSetPool::updateDescriptorSet(VkDevice device, VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet, VkPipelineLayout layout, VkDescriptorImageInfo imageInfo)
 {
     VkWriteDescriptorSet descWrite {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -152,34 +230,36 @@ inline void VulkanDescriptorSetPool<MaxFramesInFlight>::updateDescriptorSet(VkDe
     vkUpdateDescriptorSets(device, 1, &descWrite, 0, nullptr);
 }
 
-template <uint32_t MaxFramesInFlight>
-inline void VulkanDescriptorSetPool<MaxFramesInFlight>::clearPool(VkDevice device)
+inline void VulkanDescriptorSetPool::clearPool(VkDevice device)
 {
     vkResetDescriptorPool(device, _pool, 0);
-    for (uint32_t i = 0; i < MaxFramesInFlight; ++i) {
-        _descriptorSets[i].clear();
+    for (DescriptorSets& sets : _descriptorSets) {
+        sets.clear();
+    }
+
+    for (VkDescriptorPool pool : _persistentPools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
     }
+    _persistentPools.clear();
+
+    _stats = { .maxSets = _maxSets };
 }
 
-template <uint32_t MaxFramesInFlight>
-inline void VulkanDescriptorSetPool<MaxFramesInFlight>::releasePool(VkDevice device)
+inline void VulkanDescriptorSetPool::releasePool(VkDevice device)
 {
     vkDestroyDescriptorSetLayout(device, _layout, nullptr);
     vkDestroyDescriptorPool(device, _pool, nullptr);
+
+    for (VkDescriptorPool pool : _persistentPools) {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+    _persistentPools.clear();
 }
 
-template <uint32_t MaxFramesInFlight>
-inline void VulkanDescriptorSetPool<MaxFramesInFlight>::allocateSet(VkDevice device, uint32_t frameInFlightId)
+inline void VulkanDescriptorSetPool::allocateSet(VkDevice device, uint32_t frameInFlightId)
 {
-    VkDescriptorSetAllocateInfo allocInfo {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = _pool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &_layout
-    };
-
     VkDescriptorSet set;
-    if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS) {
+    if (allocateFromPool(device, _pool, set) != VK_SUCCESS) {
         TBD_ABORT_VK("Failed to allocate Vulkan descriptor set");
     }
 
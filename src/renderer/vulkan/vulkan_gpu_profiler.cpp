@@ -0,0 +1,273 @@
+#include "vulkan_gpu_profiler.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_utils.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+VulkanGpuProfiler::Scope::Scope(VulkanGpuProfiler& profiler, VkCommandBuffer commandBuffer, std::string_view name, bool pipelineStatistics)
+    : _profiler { profiler }
+    , _commandBuffer { commandBuffer }
+{
+    _profiler.beginPass(_commandBuffer, name, pipelineStatistics);
+}
+
+VulkanGpuProfiler::Scope::~Scope()
+{
+    _profiler.endPass(_commandBuffer);
+}
+
+VulkanGpuProfiler::VulkanGpuProfiler(VkInstance instance, VkDevice device, VkPhysicalDevice gpu, uint32_t queueFamilyId, uint32_t framesInFlight, bool pipelineStatistics)
+    : _pipelineStatistics { pipelineStatistics }
+{
+    static_assert(sizeof(GpuPipelineStatistics) == sizeof(uint64_t) * std::popcount(PipelineStatisticFlags), "Pipeline statistics don't match the queried flags");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(gpu, &properties);
+    _timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t familyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families { familyCount };
+    vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, families.data());
+
+    const uint32_t validBits = families[queueFamilyId].timestampValidBits;
+    _timestampMask = validBits >= 64 ? TBD_MAX_T(uint64_t) : (uint64_t(1) << validBits) - 1;
+    if (!isSupported()) {
+        TBD_WARN("The graphics queue doesn't support timestamps, GPU pass times won't be measured");
+    }
+
+#if PROJECT_DEBUG
+    _beginLabel = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT"));
+    _endLabel = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT"));
+#endif
+
+    _frames.resize(framesInFlight);
+    for (FrameQueries& frame : _frames) {
+        frame.queryPool = VKUtils::createQueryPool(device, VK_QUERY_TYPE_TIMESTAMP, 2 * MaxPasses);
+        frame.passIds.reserve(MaxPasses);
+
+        if (_pipelineStatistics) {
+            frame.statisticsPool = VKUtils::createQueryPool(device, VK_QUERY_TYPE_PIPELINE_STATISTICS, MaxPasses, PipelineStatisticFlags);
+            frame.statisticsPassIds.reserve(MaxPasses);
+        }
+    }
+
+    _openPasses.reserve(MaxPasses);
+    _passes.reserve(MaxPasses);
+    _results.resize(2 * MaxPasses);
+    _statisticsResults.resize(MaxPasses);
+}
+
+VulkanGpuProfiler::~VulkanGpuProfiler()
+{
+    TBD_ASSERT(_frames.empty(), "GPU profiler was not cleaned up");
+}
+
+bool VulkanGpuProfiler::readback(VkDevice device, uint32_t frameInFlightId)
+{
+    FrameQueries& frame = _frames[frameInFlightId];
+    if (!frame.submitted) {
+        return false;
+    }
+    frame.submitted = false;
+
+    if (!frame.statisticsPassIds.empty()) {
+        const uint32_t queryCount = static_cast<uint32_t>(frame.statisticsPassIds.size());
+        if (vkGetQueryPoolResults(device, frame.statisticsPool, 0, queryCount, queryCount * sizeof(GpuPipelineStatistics), _statisticsResults.data(), sizeof(GpuPipelineStatistics), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            for (uint32_t i = 0; i < queryCount; ++i) {
+                const GpuPipelineStatistics& result = _statisticsResults[i];
+
+                PassHistory& pass = _passes[frame.statisticsPassIds[i]];
+                pass.statisticsSum.vertexShaderInvocations += result.vertexShaderInvocations;
+                pass.statisticsSum.clippingInvocations += result.clippingInvocations;
+                pass.statisticsSum.clippingPrimitives += result.clippingPrimitives;
+                pass.statisticsSum.fragmentShaderInvocations += result.fragmentShaderInvocations;
+                pass.statisticsSum.computeShaderInvocations += result.computeShaderInvocations;
+                ++pass.statisticsCount;
+            }
+        }
+    }
+
+    if (frame.passIds.empty()) {
+        return false;
+    }
+
+    // Without the wait flag, VK_NOT_READY leaves the frame out instead of stalling
+    const uint32_t queryCount = 2 * static_cast<uint32_t>(frame.passIds.size());
+    if (vkGetQueryPoolResults(device, frame.queryPool, 0, queryCount, queryCount * sizeof(uint64_t), _results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < frame.passIds.size(); ++i) {
+        const uint64_t ticks = ((_results[2 * i + 1] & _timestampMask) - (_results[2 * i] & _timestampMask)) & _timestampMask;
+
+        PassHistory& pass = _passes[frame.passIds[i]];
+        pass.lastMs = float(ticks) * _timestampPeriod / 1e6f;
+        pass.samplesMs[pass.nextSample] = pass.lastMs;
+        pass.nextSample = (pass.nextSample + 1) % HistorySize;
+        pass.sampleCount = std::min(pass.sampleCount + 1, HistorySize);
+    }
+
+    return true;
+}
+
+void VulkanGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameInFlightId)
+{
+    TBD_ASSERT(_openPasses.empty(), "GPU passes left open in the previous frame");
+
+    _currentFrame = &_frames[frameInFlightId];
+    _currentFrame->passIds.clear();
+    _currentFrame->statisticsPassIds.clear();
+    _currentFrame->submitted = true;
+
+    if (isSupported()) {
+        vkCmdResetQueryPool(commandBuffer, _currentFrame->queryPool, 0, 2 * MaxPasses);
+    }
+    if (_pipelineStatistics) {
+        vkCmdResetQueryPool(commandBuffer, _currentFrame->statisticsPool, 0, MaxPasses);
+    }
+}
+
+void VulkanGpuProfiler::beginPass(VkCommandBuffer commandBuffer, std::string_view name, bool pipelineStatistics)
+{
+    TBD_ASSERT(_currentFrame != nullptr, "GPU pass recorded outside of a frame");
+
+    if (_beginLabel != nullptr) {
+        // Names are short literals, the copy keeps them null terminated
+        const std::string label { name };
+        VkDebugUtilsLabelEXT labelInfo {
+            .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
+            .pLabelName = label.c_str()
+        };
+        _beginLabel(commandBuffer, &labelInfo);
+    }
+
+    // Passes past the query budget still get their label, the slots tell endPass which queries to skip
+    OpenPass pass { TBD_MAX_T(uint32_t), TBD_MAX_T(uint32_t) };
+    if (isSupported() && _currentFrame->passIds.size() < MaxPasses) {
+        pass.timestampSlot = static_cast<uint32_t>(_currentFrame->passIds.size());
+        _currentFrame->passIds.push_back(getPassId(name));
+        vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _currentFrame->queryPool, 2 * pass.timestampSlot);
+    }
+
+    if (pipelineStatistics && _pipelineStatistics && !_statisticsActive && _currentFrame->statisticsPassIds.size() < MaxPasses) {
+        pass.statisticsSlot = static_cast<uint32_t>(_currentFrame->statisticsPassIds.size());
+        _currentFrame->statisticsPassIds.push_back(getPassId(name));
+        vkCmdBeginQuery(commandBuffer, _currentFrame->statisticsPool, pass.statisticsSlot, 0);
+        _statisticsActive = true;
+    }
+
+    _openPasses.push_back(pass);
+}
+
+void VulkanGpuProfiler::endPass(VkCommandBuffer commandBuffer)
+{
+    TBD_ASSERT(!_openPasses.empty(), "GPU pass ended without being started");
+
+    const OpenPass pass = _openPasses.back();
+    _openPasses.pop_back();
+
+    if (pass.statisticsSlot != TBD_MAX_T(uint32_t)) {
+        vkCmdEndQuery(commandBuffer, _currentFrame->statisticsPool, pass.statisticsSlot);
+        _statisticsActive = false;
+    }
+
+    if (pass.timestampSlot != TBD_MAX_T(uint32_t)) {
+        vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _currentFrame->queryPool, 2 * pass.timestampSlot + 1);
+    }
+
+    if (_endLabel != nullptr) {
+        _endLabel(commandBuffer);
+    }
+}
+
+float VulkanGpuProfiler::getLastMs(std::string_view name) const
+{
+    auto it = std::find_if(_passes.begin(), _passes.end(), [name](const PassHistory& pass) { return pass.name == name; });
+    return it != _passes.end() ? it->lastMs : 0.f;
+}
+
+std::vector<GpuPassStats> VulkanGpuProfiler::getStats() const
+{
+    std::vector<GpuPassStats> stats;
+    stats.reserve(_passes.size());
+
+    std::vector<float> sorted;
+    for (const PassHistory& pass : _passes) {
+        if (pass.sampleCount == 0 && pass.statisticsCount == 0) {
+            continue;
+        }
+
+        GpuPipelineStatistics averageStatistics;
+        if (pass.statisticsCount != 0) {
+            averageStatistics = GpuPipelineStatistics {
+                .vertexShaderInvocations = pass.statisticsSum.vertexShaderInvocations / pass.statisticsCount,
+                .clippingInvocations = pass.statisticsSum.clippingInvocations / pass.statisticsCount,
+                .clippingPrimitives = pass.statisticsSum.clippingPrimitives / pass.statisticsCount,
+                .fragmentShaderInvocations = pass.statisticsSum.fragmentShaderInvocations / pass.statisticsCount,
+                .computeShaderInvocations = pass.statisticsSum.computeShaderInvocations / pass.statisticsCount
+            };
+        }
+
+        if (pass.sampleCount == 0) {
+            stats.emplace_back(GpuPassStats { .name = pass.name, .hasPipelineStatistics = true, .pipelineStatistics = averageStatistics });
+            continue;
+        }
+
+        sorted.assign(pass.samplesMs.begin(), pass.samplesMs.begin() + pass.sampleCount);
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](float p) { return sorted[static_cast<size_t>(p * float(sorted.size() - 1) + 0.5f)]; };
+
+        float sum = 0.f;
+        for (float sample : sorted) {
+            sum += sample;
+        }
+
+        stats.emplace_back(GpuPassStats {
+            .name = pass.name,
+            .lastMs = pass.lastMs,
+            .averageMs = sum / float(sorted.size()),
+            .p50Ms = percentile(0.5f),
+            .p95Ms = percentile(0.95f),
+            .p99Ms = percentile(0.99f),
+            .maxMs = sorted.back(),
+            .sampleCount = pass.sampleCount,
+            .hasPipelineStatistics = pass.statisticsCount != 0,
+            .pipelineStatistics = averageStatistics });
+    }
+
+    return stats;
+}
+
+void VulkanGpuProfiler::release(VkDevice device)
+{
+    for (FrameQueries& frame : _frames) {
+        vkDestroyQueryPool(device, frame.queryPool, nullptr);
+        if (frame.statisticsPool != nullptr) {
+            vkDestroyQueryPool(device, frame.statisticsPool, nullptr);
+        }
+    }
+    _frames.clear();
+    _currentFrame = nullptr;
+}
+
+uint32_t VulkanGpuProfiler::getPassId(std::string_view name)
+{
+    auto it = std::find_if(_passes.begin(), _passes.end(), [name](const PassHistory& pass) { return pass.name == name; });
+    if (it != _passes.end()) {
+        return static_cast<uint32_t>(it - _passes.begin());
+    }
+
+    _passes.emplace_back(PassHistory { .name = std::string { name } });
+    return static_cast<uint32_t>(_passes.size() - 1);
+}
+
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <misc/utils.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+// Results of VulkanGpuProfiler::PipelineStatisticFlags, in the order of the flag bits
+struct GpuPipelineStatistics {
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+    uint64_t computeShaderInvocations = 0;
+};
+
+// GPU time of a pass over the last VulkanGpuProfiler::HistorySize frames it ran in
+struct GpuPassStats {
+    std::string name;
+    float lastMs = 0.f;
+    float averageMs = 0.f;
+    float p50Ms = 0.f;
+    float p95Ms = 0.f;
+    float p99Ms = 0.f;
+    float maxMs = 0.f;
+    uint32_t sampleCount = 0;
+
+    // Averaged over every frame the pass collected them in
+    bool hasPipelineStatistics = false;
+    GpuPipelineStatistics pipelineStatistics;
+};
+
+// Timestamps around each pass, one query pool per frame in flight, and optionally pipeline statistics.
+// Results are read back once the frame in flight completed on the timeline, so reading never waits on the GPU
+class VulkanGpuProfiler {
+    TBD_NO_COPY_MOVE(VulkanGpuProfiler)
+public:
+    static constexpr uint32_t MaxPasses = 32;
+    static constexpr uint32_t HistorySize = 256;
+
+    static constexpr VkQueryPipelineStatisticFlags PipelineStatisticFlags = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+        | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+    // Opens a pass on construction and closes it on destruction, passes can be nested
+    class Scope {
+        TBD_NO_COPY_MOVE(Scope)
+    public:
+        Scope(VulkanGpuProfiler& profiler, VkCommandBuffer commandBuffer, std::string_view name, bool pipelineStatistics = false);
+
+        ~Scope();
+
+    private:
+        VulkanGpuProfiler& _profiler;
+        VkCommandBuffer _commandBuffer;
+    };
+
+    VulkanGpuProfiler() = delete;
+
+    // Debug utils labels are only emitted when the instance enabled the extension, in debug builds.
+    // Pipeline statistics require the pipelineStatisticsQuery feature
+    VulkanGpuProfiler(VkInstance instance, VkDevice device, VkPhysicalDevice gpu, uint32_t queueFamilyId, uint32_t framesInFlight, bool pipelineStatistics = false);
+
+    ~VulkanGpuProfiler();
+
+    // The frame that last used frameInFlightId must have completed, returns false if nothing could be read
+    bool readback(VkDevice device, uint32_t frameInFlightId);
+
+    // Must be the first command of the frame, after the readback of the same frame in flight
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameInFlightId);
+
+    // Pipeline statistics queries can't be nested, they are skipped when an enclosing pass already collects them
+    void beginPass(VkCommandBuffer commandBuffer, std::string_view name, bool pipelineStatistics = false);
+
+    void endPass(VkCommandBuffer commandBuffer);
+
+    // Time of the pass in the last frame read back, 0 if it never ran
+    [[nodiscard]] float getLastMs(std::string_view name) const;
+
+    // Sorts the histories, meant for reports rather than every frame
+    [[nodiscard]] std::vector<GpuPassStats> getStats() const;
+
+    [[nodiscard]] inline bool isSupported() const { return _timestampMask != 0; }
+
+    // Secondary command buffers executed inside the passes must inherit these, 0 without pipeline statistics
+    [[nodiscard]] inline VkQueryPipelineStatisticFlags getPipelineStatisticFlags() const { return _pipelineStatistics ? PipelineStatisticFlags : 0; }
+
+    void release(VkDevice device);
+
+private:
+    [[nodiscard]] uint32_t getPassId(std::string_view name);
+
+private:
+    struct PassHistory {
+        std::string name;
+        std::array<float, HistorySize> samplesMs {};
+        uint32_t sampleCount = 0;
+        uint32_t nextSample = 0;
+        float lastMs = 0.f;
+
+        GpuPipelineStatistics statisticsSum;
+        uint64_t statisticsCount = 0;
+    };
+
+    // Passes written by a frame in flight, pass i owns the timestamps 2 * i and 2 * i + 1,
+    // statisticsPassIds[i] owns the pipeline statistics query i
+    struct FrameQueries {
+        VkQueryPool queryPool = nullptr;
+        VkQueryPool statisticsPool = nullptr;
+        std::vector<uint32_t> passIds;
+        std::vector<uint32_t> statisticsPassIds;
+        bool submitted = false;
+    };
+
+    struct OpenPass {
+        uint32_t timestampSlot;
+        uint32_t statisticsSlot;
+    };
+
+    float _timestampPeriod = 0.f;
+    uint64_t _timestampMask = 0;
+    bool _pipelineStatistics;
+
+    PFN_vkCmdBeginDebugUtilsLabelEXT _beginLabel = nullptr;
+    PFN_vkCmdEndDebugUtilsLabelEXT _endLabel = nullptr;
+
+    std::vector<FrameQueries> _frames;
+    FrameQueries* _currentFrame = nullptr;
+
+    // Query slots of the passes still open in the current frame
+    std::vector<OpenPass> _openPasses;
+    bool _statisticsActive = false;
+
+    std::vector<PassHistory> _passes;
+    std::vector<uint64_t> _results;
+    std::vector<GpuPipelineStatistics> _statisticsResults;
+};
+
+}
@@ -0,0 +1,230 @@
+#include <misc/utils.hpp>
+
+#if TBD_HUD
+
+#include "vulkan_hud.hpp"
+#include <algorithm>
+#include <backends/imgui_impl_glfw.h>
+#include <backends/imgui_impl_vulkan.h>
+#include <cstdint>
+#include <imgui.h>
+#include <renderer/core/frame_pacing.hpp>
+#include <renderer/vulkan/vulkan_memory_tracker.hpp>
+#include <renderer/vulkan/vulkan_pipeline_cache.hpp>
+#include <renderer/vulkan/vulkan_rhi.hpp>
+#include <renderer/vulkan/vulkan_texture.hpp>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+namespace {
+
+    constexpr float GraphHeight = 48.f;
+
+    void checkVkResult(VkResult result)
+    {
+        if (result < VK_SUCCESS) {
+            TBD_ABORT_VK("imgui Vulkan backend failed with VkResult " << result);
+        }
+    }
+
+    [[nodiscard]] float toMiB(VkDeviceSize bytes)
+    {
+        return float(bytes) / float(1 << 20);
+    }
+
+}
+
+VulkanHud::VulkanHud(GLFWwindow* window, VkInstance instance, VkPhysicalDevice gpu, VkDevice device, uint32_t queueFamilyId, VkQueue queue,
+    uint32_t imageCount, VkFormat colorFormat)
+{
+    // Only the font atlas is sampled
+    const VkDescriptorPoolSize poolSize { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 };
+    VkDescriptorPoolCreateInfo poolCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize
+    };
+
+    if (vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &_descriptorPool) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to create the HUD descriptor pool");
+    }
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+
+    ImGui::StyleColorsDark();
+    ImGui::GetStyle().Alpha = 0.9f;
+
+    ImGui_ImplGlfw_InitForVulkan(window, true);
+
+    // Fields are assigned rather than designated, their order changed between imgui versions
+    ImGui_ImplVulkan_InitInfo initInfo {};
+    initInfo.Instance = instance;
+    initInfo.PhysicalDevice = gpu;
+    initInfo.Device = device;
+    initInfo.QueueFamily = queueFamilyId;
+    initInfo.Queue = queue;
+    initInfo.DescriptorPool = _descriptorPool;
+    initInfo.MinImageCount = std::max(2u, imageCount);
+    initInfo.ImageCount = std::max(2u, imageCount);
+    initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+    initInfo.UseDynamicRendering = true;
+    initInfo.PipelineRenderingCreateInfo = VkPipelineRenderingCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &colorFormat
+    };
+    initInfo.CheckVkResultFn = checkVkResult;
+
+    if (!ImGui_ImplVulkan_Init(&initInfo)) {
+        TBD_ABORT_VK("Failed to initialize the imgui Vulkan backend");
+    }
+
+    TBD_LOG("Performance HUD enabled");
+}
+
+VulkanHud::~VulkanHud()
+{
+    TBD_ASSERT(_descriptorPool == nullptr, "VulkanHud destroyed before being released");
+}
+
+void VulkanHud::update(const VulkanRHI& rhi)
+{
+    _updateStart = std::chrono::steady_clock::now();
+
+    const FramePacing& pacing = rhi.getFramePacing();
+    const FrameTimings& last = pacing.getLast();
+
+    _cpuFrameMs[_nextSample] = last.frameMs;
+    _gpuFrameMs[_nextSample] = last.gpuMs;
+    _nextSample = (_nextSample + 1) % GraphSize;
+
+    // getGpuPassStats sorts every pass history
+    if (_frameCount++ % RefreshInterval == 0) {
+        _gpuPasses = rhi.getGpuPassStats();
+    }
+
+    ImGui_ImplVulkan_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2 { 10.f, 10.f }, ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowBgAlpha(0.75f);
+    ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing);
+
+    ImGui::Text("Frame %u, %.2f ms CPU, %.2f ms GPU, %s bound", last.frameId, last.frameMs, last.gpuMs, toString(last.bound));
+
+    const float graphMaxMs = std::max(*std::max_element(_cpuFrameMs.begin(), _cpuFrameMs.end()), *std::max_element(_gpuFrameMs.begin(), _gpuFrameMs.end()));
+    const ImVec2 graphSize { 320.f, GraphHeight };
+    ImGui::PlotLines("CPU ms", _cpuFrameMs.data(), GraphSize, static_cast<int>(_nextSample), nullptr, 0.f, graphMaxMs, graphSize);
+    ImGui::PlotLines("GPU ms", _gpuFrameMs.data(), GraphSize, static_cast<int>(_nextSample), nullptr, 0.f, graphMaxMs, graphSize);
+
+    // The overlay pass is named by VulkanRHI::render
+    const auto hudPass = std::find_if(_gpuPasses.begin(), _gpuPasses.end(), [](const GpuPassStats& pass) { return pass.name == "HUD"; });
+    const float hudGpuMs = hudPass != _gpuPasses.end() ? hudPass->p95Ms : 0.f;
+    if (hudGpuMs > GpuBudgetMs) {
+        ImGui::TextColored(ImVec4 { 1.f, 0.3f, 0.3f, 1.f }, "HUD: %.3f ms CPU, %.3f ms GPU p95, over the %.1f ms budget", _cpuCostMs, hudGpuMs, GpuBudgetMs);
+    } else {
+        ImGui::Text("HUD: %.3f ms CPU, %.3f ms GPU p95, budget %.1f ms", _cpuCostMs, hudGpuMs, GpuBudgetMs);
+    }
+
+    if (ImGui::CollapsingHeader("GPU passes", ImGuiTreeNodeFlags_DefaultOpen) && ImGui::BeginTable("GPU passes", 4)) {
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableHeadersRow();
+        for (const GpuPassStats& pass : _gpuPasses) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(pass.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.lastMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.p50Ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.p95Ms);
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::CollapsingHeader("CPU frame", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Text("Record %.3f ms, submit %.3f ms, present %.3f ms", last.recordMs, last.submitMs, last.presentMs);
+        ImGui::Text("Waits: fence %.3f ms, acquire %.3f ms, present %.3f ms", last.fenceWaitMs, last.acquireWaitMs, last.presentWaitMs);
+
+        const float frameCount = float(std::max(1u, pacing.getFrameCount()));
+        ImGui::Text("Bound over %u frames: CPU %.0f%%, GPU %.0f%%, present %.0f%%", pacing.getFrameCount(),
+            100.f * float(pacing.getBoundCount(FrameBound::Cpu)) / frameCount,
+            100.f * float(pacing.getBoundCount(FrameBound::Gpu)) / frameCount,
+            100.f * float(pacing.getBoundCount(FrameBound::Present)) / frameCount);
+    }
+
+    if (ImGui::CollapsingHeader("Memory")) {
+        const VulkanMemoryTracker& memory = rhi.getMemoryTracker();
+        for (size_t i = 0; i < static_cast<size_t>(MemoryCategory::Count); ++i) {
+            const MemoryCategoryStats& category = memory.getCategoryStats(static_cast<MemoryCategory>(i));
+            if (category.peakAllocationCount != 0) {
+                ImGui::Text("%s: %.1f MiB in %u allocations, %.1f MiB peak", toString(static_cast<MemoryCategory>(i)), toMiB(category.bytes),
+                    category.allocationCount, toMiB(category.peakBytes));
+            }
+        }
+        for (const MemoryHeapStats& heap : memory.getHeapStats()) {
+            if (heap.deviceLocal) {
+                ImGui::Text("Device local heap: %.0f / %.0f MiB", toMiB(heap.usage), toMiB(heap.budget));
+            }
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Caches")) {
+        const PipelineCacheStats& pipelines = rhi.getPipelineCacheStats();
+        ImGui::Text("Pipelines: %u for %u requests, %u VkPipelines", pipelines.pipelineCount, pipelines.pipelineRequests, pipelines.vkPipelineCount);
+        ImGui::Text("Layouts: %u, shader modules: %u, %.1f ms of creation", pipelines.layoutCount, pipelines.shaderModuleCount, pipelines.creationTimeMs);
+
+        const DescriptorSetPoolStats& descriptors = rhi.getDescriptorSetPoolStats();
+        ImGui::Text("Descriptor sets: %u of %u", descriptors.allocatedSets, descriptors.maxSets);
+
+        const RecordedPassStats& recordedPasses = rhi.getRecordedPassStats();
+        ImGui::Text("Recorded passes: %u recordings, %u replays", recordedPasses.recordCount, recordedPasses.replayCount);
+    }
+
+    ImGui::End();
+    ImGui::Render();
+}
+
+void VulkanHud::render(VkCommandBuffer commandBuffer, const VulkanTexture& target, VkExtent2D extent)
+{
+    const VkRenderingAttachmentInfo attachment = target.getAttachmentInfo();
+    VkRenderingInfo renderingInfo {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .renderArea = VkRect2D { {}, extent },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &attachment
+    };
+
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    vkCmdEndRendering(commandBuffer);
+
+    _cpuCostMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _updateStart).count();
+}
+
+void VulkanHud::release(VkDevice device)
+{
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    vkDestroyDescriptorPool(device, _descriptorPool, nullptr);
+    _descriptorPool = nullptr;
+}
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_gpu_profiler.hpp>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+struct GLFWwindow;
+
+namespace TBD {
+
+class VulkanRHI;
+class VulkanTexture;
+
+// Performance overlay drawn with imgui over the final image, only built with TBD_HUD, outside of release builds.
+// Graphs are updated every frame, the sorted statistics a few times per second
+class VulkanHud {
+    TBD_NO_COPY_MOVE(VulkanHud)
+public:
+    static constexpr uint32_t GraphSize = 240;
+    static constexpr uint32_t RefreshInterval = 30;
+
+    // GPU time the overlay may take, its own pass is flagged above it
+    static constexpr float GpuBudgetMs = 0.2f;
+
+    VulkanHud() = delete;
+
+    // Installs the imgui input callbacks on top of the window ones, the pipeline targets colorFormat with dynamic rendering
+    VulkanHud(GLFWwindow* window, VkInstance instance, VkPhysicalDevice gpu, VkDevice device, uint32_t queueFamilyId, VkQueue queue,
+        uint32_t imageCount, VkFormat colorFormat);
+
+    ~VulkanHud();
+
+    // Builds the UI from the statistics of the previous frames
+    void update(const VulkanRHI& rhi);
+
+    // Loads and draws over target, which must be in the color attachment layout
+    void render(VkCommandBuffer commandBuffer, const VulkanTexture& target, VkExtent2D extent);
+
+    void release(VkDevice device);
+
+private:
+    VkDescriptorPool _descriptorPool = nullptr;
+
+    std::array<float, GraphSize> _cpuFrameMs {};
+    std::array<float, GraphSize> _gpuFrameMs {};
+    uint32_t _nextSample = 0;
+    uint32_t _frameCount = 0;
+
+    // CPU cost of the overlay, from the start of update to the end of render of the previous frame
+    std::chrono::steady_clock::time_point _updateStart;
+    float _cpuCostMs = 0.f;
+
+    std::vector<GpuPassStats> _gpuPasses;
+};
+
+}
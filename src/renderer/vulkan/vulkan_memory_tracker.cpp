@@ -0,0 +1,147 @@
+#include "vulkan_memory_tracker.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <misc/utils.hpp>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+const char* toString(MemoryCategory category)
+{
+    switch (category) {
+    case MemoryCategory::RenderTarget:
+        return "Render target";
+    case MemoryCategory::StreamedTexture:
+        return "Streamed texture";
+    case MemoryCategory::Staging:
+        return "Staging";
+    case MemoryCategory::Geometry:
+        return "Geometry";
+    case MemoryCategory::Transient:
+        return "Transient";
+    default:
+        return "Unknown";
+    }
+}
+
+VulkanMemoryTracker::VulkanMemoryTracker(VmaAllocator allocator)
+    : _allocator { allocator }
+{
+    const VkPhysicalDeviceMemoryProperties* memoryProperties;
+    vmaGetMemoryProperties(_allocator, &memoryProperties);
+
+    _heaps.resize(memoryProperties->memoryHeapCount);
+    _budgets.resize(memoryProperties->memoryHeapCount);
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i) {
+        _heaps[i].size = memoryProperties->memoryHeaps[i].size;
+        _heaps[i].deviceLocal = memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+
+    update(0);
+}
+
+void VulkanMemoryTracker::track(VmaAllocation allocation, MemoryCategory category)
+{
+    // Offset by one so that untagged allocations read as nullptr
+    vmaSetAllocationUserData(_allocator, allocation, reinterpret_cast<void*>(static_cast<uintptr_t>(category) + 1));
+    vmaSetAllocationName(_allocator, allocation, toString(category));
+
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(_allocator, allocation, &info);
+
+    MemoryCategoryStats& stats = _categories[static_cast<size_t>(category)];
+    stats.bytes += info.size;
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+    ++stats.allocationCount;
+    stats.peakAllocationCount = std::max(stats.peakAllocationCount, stats.allocationCount);
+}
+
+void VulkanMemoryTracker::untrack(VmaAllocation allocation)
+{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(_allocator, allocation, &info);
+
+    const uintptr_t tag = reinterpret_cast<uintptr_t>(info.pUserData);
+    if (tag == 0) {
+        return;
+    }
+
+    MemoryCategoryStats& stats = _categories[tag - 1];
+    TBD_ASSERT(stats.allocationCount != 0 && stats.bytes >= info.size, "Memory category released more than it allocated");
+    stats.bytes -= info.size;
+    --stats.allocationCount;
+}
+
+void VulkanMemoryTracker::update(uint32_t frameId)
+{
+    // Lets VMA refresh the VK_EXT_memory_budget values at its own pace
+    vmaSetCurrentFrameIndex(_allocator, frameId);
+    vmaGetHeapBudgets(_allocator, _budgets.data());
+
+    for (uint32_t i = 0; i < _heaps.size(); ++i) {
+        MemoryHeapStats& heap = _heaps[i];
+        const VmaBudget& budget = _budgets[i];
+
+        heap.budget = budget.budget;
+        heap.usage = budget.usage;
+        heap.peakUsage = std::max(heap.peakUsage, budget.usage);
+        heap.blockBytes = budget.statistics.blockBytes;
+        heap.allocationBytes = budget.statistics.allocationBytes;
+        heap.blockCount = budget.statistics.blockCount;
+        heap.allocationCount = budget.statistics.allocationCount;
+    }
+}
+
+VkDeviceSize VulkanMemoryTracker::getDeviceLocalHeadroom() const
+{
+    VkDeviceSize headroom = 0;
+    for (const MemoryHeapStats& heap : _heaps) {
+        if (heap.deviceLocal) {
+            headroom += heap.getHeadroom();
+        }
+    }
+
+    return headroom;
+}
+
+void VulkanMemoryTracker::logStats() const
+{
+    for (uint32_t i = 0; i < _heaps.size(); ++i) {
+        const MemoryHeapStats& heap = _heaps[i];
+        TBD_LOG("Memory heap " << i << (heap.deviceLocal ? " (device local)" : "") << ": " << (heap.usage >> 20) << "MiB used of a "
+                               << (heap.budget >> 20) << "MiB budget, " << (heap.peakUsage >> 20) << "MiB peak, "
+                               << heap.allocationCount << " allocations in " << heap.blockCount << " blocks");
+    }
+
+    for (size_t i = 0; i < _categories.size(); ++i) {
+        const MemoryCategoryStats& category = _categories[i];
+        if (category.peakAllocationCount == 0) {
+            continue;
+        }
+
+        TBD_LOG("Memory category " << toString(static_cast<MemoryCategory>(i)) << ": " << (category.bytes >> 10) << "KiB in "
+                                   << category.allocationCount << " allocations, " << (category.peakBytes >> 10) << "KiB in "
+                                   << category.peakAllocationCount << " allocations at peak");
+    }
+}
+
+bool VulkanMemoryTracker::writeJson(const std::filesystem::path& path) const
+{
+    std::ofstream file { path };
+    if (!file.is_open()) {
+        TBD_WARN("Failed to open the memory stats file \"" << path.string() << "\"");
+        return false;
+    }
+
+    char* statsString;
+    vmaBuildStatsString(_allocator, &statsString, VK_TRUE);
+    file << statsString;
+    vmaFreeStatsString(_allocator, statsString);
+
+    TBD_LOG("Memory stats written to \"" << path.string() << "\"");
+    return file.good();
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <misc/utils.hpp>
+#include <span>
+#include <vector>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+// What an allocation is used for, stored in its VMA user data and name
+enum class MemoryCategory : uint8_t {
+    RenderTarget,
+    StreamedTexture,
+    Staging,
+    Geometry,
+    Transient,
+    Count
+};
+
+[[nodiscard]] const char* toString(MemoryCategory category);
+
+struct MemoryCategoryStats {
+    VkDeviceSize bytes = 0;
+    VkDeviceSize peakBytes = 0;
+    uint32_t allocationCount = 0;
+    uint32_t peakAllocationCount = 0;
+};
+
+struct MemoryHeapStats {
+    VkDeviceSize size = 0;
+    bool deviceLocal = false;
+
+    // Estimated by VMA from its own allocations without VK_EXT_memory_budget
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    VkDeviceSize peakUsage = 0;
+
+    // VMA blocks and the allocations suballocated from them
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize allocationBytes = 0;
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+
+    [[nodiscard]] inline VkDeviceSize getHeadroom() const { return budget > usage ? budget - usage : 0; }
+};
+
+// Category totals of the tracked allocations and heap budgets of the allocator, refreshed every frame.
+// Allocations are only made from the render thread, nothing is synchronized
+class VulkanMemoryTracker {
+    TBD_NO_COPY_MOVE(VulkanMemoryTracker)
+public:
+    VulkanMemoryTracker() = delete;
+
+    VulkanMemoryTracker(VmaAllocator allocator);
+
+    // Right after the allocation is created
+    void track(VmaAllocation allocation, MemoryCategory category);
+
+    // Right before the allocation is destroyed
+    void untrack(VmaAllocation allocation);
+
+    // Refreshes the heap budgets, called once per frame
+    void update(uint32_t frameId);
+
+    [[nodiscard]] inline const MemoryCategoryStats& getCategoryStats(MemoryCategory category) const { return _categories[static_cast<size_t>(category)]; }
+
+    [[nodiscard]] inline std::span<const MemoryHeapStats> getHeapStats() const { return _heaps; }
+
+    // Budget left in the device local heaps
+    [[nodiscard]] VkDeviceSize getDeviceLocalHeadroom() const;
+
+    void logStats() const;
+
+    // Detailed vmaBuildStatsString JSON, allocations are named after their category
+    bool writeJson(const std::filesystem::path& path) const;
+
+private:
+    VmaAllocator _allocator;
+
+    std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::Count)> _categories {};
+    std::vector<MemoryHeapStats> _heaps;
+    std::vector<VmaBudget> _budgets;
+};
+
+}
@@ -1,39 +1,252 @@
 #include "vulkan_pipeline.hpp"
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <filesystem>
-#include <fstream>
 #include <misc/utils.hpp>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan_core.h>
 
 namespace TBD {
 
-VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, const PipelineShaderData& shaderData)
+namespace {
+
+    // FNV-1a, std::hash gives no guarantee of stability between runs or standard libraries
+    constexpr uint64_t FNVOffsetBasis = 14695981039346656037ull;
+    constexpr uint64_t FNVPrime = 1099511628211ull;
+
+    inline void hashBytes(uint64_t& hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= FNVPrime;
+        }
+    }
+
+    template <typename T>
+    inline void hashValue(uint64_t& hash, T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        hashBytes(hash, &value, sizeof(T));
+    }
+
+    // Dynamic topology must stay in the class of the topology the pipeline was created with
+    inline VkPrimitiveTopology getTopologyClass(VkPrimitiveTopology topology)
+    {
+        switch (topology) {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+            return VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+        default:
+            return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        }
+    }
+
+    inline void hashShader(uint64_t& hash, const ShaderReflection* shader)
+    {
+        const std::string_view name = shader != nullptr ? shader->name : "";
+        hashValue(hash, name.size());
+        hashBytes(hash, name.data(), name.size());
+    }
+
+}
+
+uint64_t PipelineDesc::hash() const
+{
+    uint64_t hash = FNVOffsetBasis;
+
+    hashShader(hash, shaders.computeShader);
+    hashShader(hash, shaders.vertexShader);
+    hashShader(hash, shaders.fragmentShader);
+
+    hashValue(hash, shaders.specializationConstants.size());
+    for (SpecializationConstant constant : shaders.specializationConstants) {
+        hashValue(hash, constant.id);
+        hashValue(hash, constant.value);
+    }
+
+    if (isCompute()) {
+        hashValue(hash, shaders.workgroupSize.x);
+        hashValue(hash, shaders.workgroupSize.y);
+        hashValue(hash, shaders.workgroupSize.z);
+        return hash;
+    }
+
+    hashValue(hash, raster.topology);
+    hashValue(hash, raster.polygonMode);
+    hashValue(hash, raster.cullMode);
+    hashValue(hash, raster.frontFace);
+
+    hashValue(hash, depth.testEnable);
+    hashValue(hash, depth.writeEnable);
+    hashValue(hash, depth.compareOp);
+
+    hashValue(hash, blend.enable);
+    hashValue(hash, blend.srcColorFactor);
+    hashValue(hash, blend.dstColorFactor);
+    hashValue(hash, blend.colorOp);
+    hashValue(hash, blend.srcAlphaFactor);
+    hashValue(hash, blend.dstAlphaFactor);
+    hashValue(hash, blend.alphaOp);
+    hashValue(hash, blend.writeMask);
+
+    hashValue(hash, colorAttachmentFormats.size());
+    for (VkFormat format : colorAttachmentFormats) {
+        hashValue(hash, format);
+    }
+    hashValue(hash, depthAttachmentFormat);
+    hashValue(hash, stencilAttachmentFormat);
+
+    return hash;
+}
+
+PipelineDesc PipelineDesc::getStaticDesc(PipelineDynamicStateFlags dynamicStates) const
+{
+    PipelineDesc desc = *this;
+    if (isCompute()) {
+        return desc;
+    }
+
+    const PipelineRasterState defaultRaster;
+    const PipelineDepthState defaultDepth;
+    const PipelineBlendState defaultBlend;
+
+    if (dynamicStates & PipelineDynamicStateCullMode) {
+        desc.raster.cullMode = defaultRaster.cullMode;
+    }
+    if (dynamicStates & PipelineDynamicStateFrontFace) {
+        desc.raster.frontFace = defaultRaster.frontFace;
+    }
+    if (dynamicStates & PipelineDynamicStateTopologyUnrestricted) {
+        desc.raster.topology = defaultRaster.topology;
+    } else if (dynamicStates & PipelineDynamicStateTopology) {
+        desc.raster.topology = getTopologyClass(desc.raster.topology);
+    }
+    if (dynamicStates & PipelineDynamicStatePolygonMode) {
+        desc.raster.polygonMode = defaultRaster.polygonMode;
+    }
+
+    if (dynamicStates & PipelineDynamicStateDepthTestEnable) {
+        desc.depth.testEnable = defaultDepth.testEnable;
+    }
+    if (dynamicStates & PipelineDynamicStateDepthWriteEnable) {
+        desc.depth.writeEnable = defaultDepth.writeEnable;
+    }
+    if (dynamicStates & PipelineDynamicStateDepthCompareOp) {
+        desc.depth.compareOp = defaultDepth.compareOp;
+    }
+
+    if (dynamicStates & PipelineDynamicStateBlendEnable) {
+        desc.blend.enable = defaultBlend.enable;
+    }
+    if (dynamicStates & PipelineDynamicStateBlendEquation) {
+        desc.blend.srcColorFactor = defaultBlend.srcColorFactor;
+        desc.blend.dstColorFactor = defaultBlend.dstColorFactor;
+        desc.blend.colorOp = defaultBlend.colorOp;
+        desc.blend.srcAlphaFactor = defaultBlend.srcAlphaFactor;
+        desc.blend.dstAlphaFactor = defaultBlend.dstAlphaFactor;
+        desc.blend.alphaOp = defaultBlend.alphaOp;
+    }
+    if (dynamicStates & PipelineDynamicStateColorWriteMask) {
+        desc.blend.writeMask = defaultBlend.writeMask;
+    }
+
+    return desc;
+}
+
+VkPushConstantRange PipelineDesc::getPushConstantRange() const
+{
+    VkPushConstantRange range { .offset = TBD_MAX_T(uint32_t) };
+    uint32_t end = 0;
+
+    for (const ShaderReflection* shader : { shaders.computeShader, shaders.vertexShader, shaders.fragmentShader }) {
+        if (shader == nullptr) {
+            continue;
+        }
+
+        for (ShaderPushConstantRange shaderRange : shader->pushConstantRanges) {
+            range.stageFlags |= shader->stage;
+            range.offset = std::min(range.offset, shaderRange.offset);
+            end = std::max(end, shaderRange.offset + shaderRange.size);
+        }
+    }
+
+    if (range.stageFlags == 0) {
+        return {};
+    }
+
+    range.size = end - range.offset;
+    return range;
+}
+
+VulkanPipeline::VulkanPipeline(VkDevice device, VkPipelineCache cache, VkPipelineLayout layout, const PipelineShaderModules& modules, const PipelineDesc& desc,
+    PipelineDynamicStateFlags dynamicStates, const PipelineDynamicStateFunctions* dynamicStateFunctions)
+    : _pipelineLayout { layout }
+    , _pushConstantRange { desc.getPushConstantRange() }
+    , _staticDesc { desc.getStaticDesc(desc.isCompute() ? 0 : dynamicStates) }
+    , _dynamicStates { desc.isCompute() ? 0 : dynamicStates }
+    , _dynamicStateFunctions { dynamicStateFunctions }
+    , _raster { desc.raster }
+    , _depth { desc.depth }
+    , _blend { desc.blend }
+    , _colorAttachmentCount { static_cast<uint32_t>(desc.colorAttachmentFormats.size()) }
 {
-    VkPipelineLayoutCreateInfo layoutCreateInfo {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = layout != nullptr ? 1u : 0u,
-        .pSetLayouts = &layout
+    TBD_ASSERT(!(_dynamicStates & (PipelineDynamicStatePolygonMode | PipelineDynamicStateBlendEnable | PipelineDynamicStateBlendEquation | PipelineDynamicStateColorWriteMask)) || _dynamicStateFunctions != nullptr,
+        "VK_EXT_extended_dynamic_state3 states require the extension entry points");
+
+    std::vector<VkSpecializationMapEntry> specEntries;
+    std::vector<uint32_t> specData;
+    auto addSpecializationConstant = [&](uint32_t id, uint32_t value) {
+        specEntries.emplace_back(VkSpecializationMapEntry { .constantID = id, .offset = static_cast<uint32_t>(specData.size() * sizeof(uint32_t)), .size = sizeof(uint32_t) });
+        specData.emplace_back(value);
     };
 
-    if (vkCreatePipelineLayout(device, &layoutCreateInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
-        TBD_ABORT_VK("Failed to create the pipeline layout");
+    for (SpecializationConstant constant : desc.shaders.specializationConstants) {
+        addSpecializationConstant(constant.id, constant.value);
     }
 
-    if (shaderData.computeShaderPath.empty() && (shaderData.vertexShaderPath.empty() || shaderData.fragmentShaderPath.empty())) {
-        TBD_ABORT_VK("mandatory vulkan shader path missing");
-    } else if (!shaderData.computeShaderPath.empty()) {
-        VkShaderModule module;
-        if (!loadShader(device, shaderData.computeShaderPath, module)) {
-            release(device);
+    if (desc.isCompute()) {
+        const ShaderReflection& shader = *desc.shaders.computeShader;
+
+        for (uint32_t i = 0; i < 3; ++i) {
+            _workgroupSize[i] = shader.workgroupSize[i];
+
+            if (desc.shaders.workgroupSize[i] != 0) {
+                TBD_ASSERT(shader.workgroupSizeSpecIds[i] != InvalidSpecId, "Workgroup size of \"" << shader.name << "\" can't be specialized");
+
+                _workgroupSize[i] = desc.shaders.workgroupSize[i];
+                addSpecializationConstant(shader.workgroupSizeSpecIds[i], _workgroupSize[i]);
+            }
         }
-        _shaderModules.emplace_back(module);
+    }
+
+    const VkSpecializationInfo specInfo {
+        .mapEntryCount = static_cast<uint32_t>(specEntries.size()),
+        .pMapEntries = specEntries.data(),
+        .dataSize = specData.size() * sizeof(uint32_t),
+        .pData = specData.data()
+    };
+    const VkSpecializationInfo* pSpecInfo = specEntries.empty() ? nullptr : &specInfo;
+
+    if (desc.isCompute()) {
+        TBD_ASSERT(modules.compute != nullptr, "Missing compute shader module");
 
         VkPipelineShaderStageCreateInfo stageCreateInfo {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_COMPUTE_BIT,
-            .module = _shaderModules[0],
-            .pName = "main"
+            .module = modules.compute,
+            .pName = "main",
+            .pSpecializationInfo = pSpecInfo
         };
 
         VkComputePipelineCreateInfo pipelineCreateInfo {
@@ -42,7 +255,7 @@ VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, co
             .layout = _pipelineLayout,
         };
 
-        if (vkCreateComputePipelines(device, nullptr, 1, &pipelineCreateInfo, nullptr, &_pipeline) != VK_SUCCESS) {
+        if (vkCreateComputePipelines(device, cache, 1, &pipelineCreateInfo, nullptr, &_pipeline) != VK_SUCCESS) {
             TBD_ABORT_VK("Failed to create Vulkan compute pipeline");
         }
     } else {
@@ -50,15 +263,15 @@ VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, co
 
         VkPipelineInputAssemblyStateCreateInfo iasCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .topology = desc.raster.topology,
             .primitiveRestartEnable = VK_FALSE
         };
 
         VkPipelineRasterizationStateCreateInfo rasterCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-            .polygonMode = VK_POLYGON_MODE_FILL,
-            .cullMode = VK_CULL_MODE_BACK_BIT,
-            .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .polygonMode = desc.raster.polygonMode,
+            .cullMode = desc.raster.cullMode,
+            .frontFace = desc.raster.frontFace,
             .lineWidth = 1.f
         };
 
@@ -79,9 +292,9 @@ VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, co
 
         VkPipelineDepthStencilStateCreateInfo depthStencilCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-            .depthTestEnable = VK_TRUE,
-            .depthWriteEnable = VK_TRUE,
-            .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+            .depthTestEnable = desc.depth.testEnable ? VK_TRUE : VK_FALSE,
+            .depthWriteEnable = desc.depth.writeEnable ? VK_TRUE : VK_FALSE,
+            .depthCompareOp = desc.depth.compareOp,
             .depthBoundsTestEnable = VK_FALSE,
             .stencilTestEnable = VK_FALSE,
             .front = {},
@@ -90,50 +303,67 @@ VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, co
             .maxDepthBounds = 1.f
         };
 
-        VkPipelineColorBlendAttachmentState blendAttachment {
-            .blendEnable = VK_FALSE,
-            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+        const VkPipelineColorBlendAttachmentState blendAttachment {
+            .blendEnable = desc.blend.enable ? VK_TRUE : VK_FALSE,
+            .srcColorBlendFactor = desc.blend.srcColorFactor,
+            .dstColorBlendFactor = desc.blend.dstColorFactor,
+            .colorBlendOp = desc.blend.colorOp,
+            .srcAlphaBlendFactor = desc.blend.srcAlphaFactor,
+            .dstAlphaBlendFactor = desc.blend.dstAlphaFactor,
+            .alphaBlendOp = desc.blend.alphaOp,
+            .colorWriteMask = desc.blend.writeMask
         };
+        std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(desc.colorAttachmentFormats.size(), blendAttachment);
 
         VkPipelineColorBlendStateCreateInfo blendCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
             .logicOpEnable = VK_FALSE, // TODO: hmmmm
             .logicOp = VK_LOGIC_OP_COPY,
-            .attachmentCount = 1,
-            .pAttachments = &blendAttachment
+            .attachmentCount = static_cast<uint32_t>(blendAttachments.size()),
+            .pAttachments = blendAttachments.data()
         };
 
-        VkDynamicState dynState[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        std::vector<VkDynamicState> dynState = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        const std::pair<PipelineDynamicStateBits, VkDynamicState> dynamicStateMapping[] = {
+            { PipelineDynamicStateCullMode, VK_DYNAMIC_STATE_CULL_MODE },
+            { PipelineDynamicStateFrontFace, VK_DYNAMIC_STATE_FRONT_FACE },
+            { PipelineDynamicStateTopology, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY },
+            { PipelineDynamicStateDepthTestEnable, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE },
+            { PipelineDynamicStateDepthWriteEnable, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE },
+            { PipelineDynamicStateDepthCompareOp, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP },
+            { PipelineDynamicStatePolygonMode, VK_DYNAMIC_STATE_POLYGON_MODE_EXT },
+            { PipelineDynamicStateBlendEnable, VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT },
+            { PipelineDynamicStateBlendEquation, VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT },
+            { PipelineDynamicStateColorWriteMask, VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT },
+        };
+        for (auto [flag, state] : dynamicStateMapping) {
+            if (_dynamicStates & flag) {
+                dynState.emplace_back(state);
+            }
+        }
+
         VkPipelineDynamicStateCreateInfo dynStateCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-            .dynamicStateCount = sizeof(dynState) / sizeof(VkDynamicState),
-            .pDynamicStates = dynState
+            .dynamicStateCount = static_cast<uint32_t>(dynState.size()),
+            .pDynamicStates = dynState.data()
         };
 
-        VkShaderModule vertexShader;
-        if (!loadShader(device, shaderData.vertexShaderPath, vertexShader)) {
-            release(device);
-        }
-        _shaderModules.emplace_back(vertexShader);
-
-        VkShaderModule fragmentShader;
-        if (!loadShader(device, shaderData.fragmentShaderPath, fragmentShader)) {
-            release(device);
-        }
-        _shaderModules.emplace_back(fragmentShader);
+        TBD_ASSERT(modules.vertex != nullptr && modules.fragment != nullptr, "Missing graphics shader module");
 
         VkPipelineShaderStageCreateInfo vertexStageCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vertexShader,
-            .pName = "main"
+            .module = modules.vertex,
+            .pName = "main",
+            .pSpecializationInfo = pSpecInfo
         };
 
         VkPipelineShaderStageCreateInfo fragmentStageCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = fragmentShader,
-            .pName = "main"
+            .module = modules.fragment,
+            .pName = "main",
+            .pSpecializationInfo = pSpecInfo
         };
 
         const VkPipelineShaderStageCreateInfo stagesCI[] = {
@@ -143,10 +373,10 @@ VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, co
 
         VkPipelineRenderingCreateInfo renderCI {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
-            .colorAttachmentCount = static_cast<uint32_t>(shaderData.colorAttachmentFormats.size()),
-            .pColorAttachmentFormats = shaderData.colorAttachmentFormats.data(),
-            .depthAttachmentFormat = shaderData.depthAttachmentFormat,
-            .stencilAttachmentFormat = shaderData.stencilAttachmentFormat
+            .colorAttachmentCount = static_cast<uint32_t>(desc.colorAttachmentFormats.size()),
+            .pColorAttachmentFormats = desc.colorAttachmentFormats.data(),
+            .depthAttachmentFormat = desc.depthAttachmentFormat,
+            .stencilAttachmentFormat = desc.stencilAttachmentFormat
         };
 
         VkGraphicsPipelineCreateInfo pipelineCreateInfo {
@@ -165,20 +395,50 @@ VulkanPipeline::VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, co
             .layout = _pipelineLayout
         };
 
-        if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineCreateInfo, nullptr, &_pipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineCreateInfo, nullptr, &_pipeline) != VK_SUCCESS) {
             TBD_ABORT_VK("Failed to create graphics pipeline");
         }
     }
 }
 
-void VulkanPipeline::dispatch(VkCommandBuffer commandBuffer, Vec3i kernelSize)
+VulkanPipeline::VulkanPipeline(const VulkanPipeline& base, const PipelineDesc& desc)
+    : _pipeline { base._pipeline }
+    , _pipelineLayout { base._pipelineLayout }
+    , _ownsPipeline { false }
+    , _pushConstantRange { base._pushConstantRange }
+    , _workgroupSize { base._workgroupSize }
+    , _staticDesc { base._staticDesc }
+    , _dynamicStates { base._dynamicStates }
+    , _dynamicStateFunctions { base._dynamicStateFunctions }
+    , _raster { desc.raster }
+    , _depth { desc.depth }
+    , _blend { desc.blend }
+    , _colorAttachmentCount { base._colorAttachmentCount }
+{
+    TBD_ASSERT(base.canShare(desc), "Pipeline variant differs by a static state");
+}
+
+bool VulkanPipeline::canShare(const PipelineDesc& desc) const
+{
+    return desc.getStaticDesc(_dynamicStates) == _staticDesc;
+}
+
+void VulkanPipeline::dispatch(VkCommandBuffer commandBuffer, Vec3u invocationCount)
 {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
 
-    vkCmdDispatch(commandBuffer, kernelSize.x, kernelSize.y, kernelSize.z);
+    const Vec3u groupCount = (invocationCount + _workgroupSize - 1u) / _workgroupSize;
+    vkCmdDispatch(commandBuffer, groupCount.x, groupCount.y, groupCount.z);
 }
 
 void VulkanPipeline::draw(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<VkRenderingAttachmentInfo>& attachments, VkRenderingAttachmentInfo depthAttachment, VkRenderingAttachmentInfo stencilAttachment)
+{
+    beginRendering(commandBuffer, extent, attachments, depthAttachment, stencilAttachment);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    endRendering(commandBuffer);
+}
+
+void VulkanPipeline::beginRendering(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<VkRenderingAttachmentInfo>& attachments, VkRenderingAttachmentInfo depthAttachment, VkRenderingAttachmentInfo stencilAttachment)
 {
     VkRenderingInfo renderingInfo {
         .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
@@ -210,53 +470,80 @@ void VulkanPipeline::draw(VkCommandBuffer commandBuffer, VkExtent2D extent, cons
 
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    setDynamicStates(commandBuffer);
+}
 
+void VulkanPipeline::endRendering(VkCommandBuffer commandBuffer)
+{
     vkCmdEndRendering(commandBuffer);
 }
 
-void VulkanPipeline::release(VkDevice device)
+void VulkanPipeline::setDynamicStates(VkCommandBuffer commandBuffer) const
 {
-    if (_pipelineLayout) {
-        vkDestroyPipelineLayout(device, _pipelineLayout, nullptr);
+    if (_dynamicStates == 0) {
+        return;
     }
 
-    for (VkShaderModule module : _shaderModules) {
-        vkDestroyShaderModule(device, module, nullptr);
+    if (_dynamicStates & PipelineDynamicStateCullMode) {
+        vkCmdSetCullMode(commandBuffer, _raster.cullMode);
     }
-
-    if (_pipeline) {
-        vkDestroyPipeline(device, _pipeline, nullptr);
+    if (_dynamicStates & PipelineDynamicStateFrontFace) {
+        vkCmdSetFrontFace(commandBuffer, _raster.frontFace);
     }
-}
-
-bool VulkanPipeline::loadShader(VkDevice device, const std::filesystem::path& path, VkShaderModule& module) const
-{
-    if (!path.has_filename() || !std::filesystem::exists(path)) {
-        TBD_WARN("Shader at \"" << path << "\" does not exist");
-        return false;
+    if (_dynamicStates & PipelineDynamicStateTopology) {
+        vkCmdSetPrimitiveTopology(commandBuffer, _raster.topology);
+    }
+    if (_dynamicStates & PipelineDynamicStatePolygonMode) {
+        _dynamicStateFunctions->setPolygonMode(commandBuffer, _raster.polygonMode);
     }
 
-    std::ifstream file { path, std::ios::ate | std::ios::binary };
-    if (!file.is_open()) {
-        TBD_WARN("Failed to open shader at \"" << path << "\"");
-        return false;
+    if (_dynamicStates & PipelineDynamicStateDepthTestEnable) {
+        vkCmdSetDepthTestEnable(commandBuffer, _depth.testEnable ? VK_TRUE : VK_FALSE);
+    }
+    if (_dynamicStates & PipelineDynamicStateDepthWriteEnable) {
+        vkCmdSetDepthWriteEnable(commandBuffer, _depth.writeEnable ? VK_TRUE : VK_FALSE);
+    }
+    if (_dynamicStates & PipelineDynamicStateDepthCompareOp) {
+        vkCmdSetDepthCompareOp(commandBuffer, _depth.compareOp);
     }
 
-    size_t size = file.tellg();
-    file.seekg(0);
+    if (_colorAttachmentCount == 0) {
+        return;
+    }
 
-    std::vector<char> buffer(size);
-    file.read(buffer.data(), size);
-    file.close();
+    // Same blend state for every attachment, see PipelineBlendState
+    static constexpr uint32_t MaxColorAttachments = 8;
+    TBD_ASSERT(_colorAttachmentCount <= MaxColorAttachments, "Too many color attachments");
 
-    VkShaderModuleCreateInfo moduleCreateInfo {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = size,
-        .pCode = reinterpret_cast<uint32_t*>(buffer.data())
-    };
+    if (_dynamicStates & PipelineDynamicStateBlendEnable) {
+        std::array<VkBool32, MaxColorAttachments> enables;
+        enables.fill(_blend.enable ? VK_TRUE : VK_FALSE);
+        _dynamicStateFunctions->setColorBlendEnable(commandBuffer, 0, _colorAttachmentCount, enables.data());
+    }
+    if (_dynamicStates & PipelineDynamicStateBlendEquation) {
+        std::array<VkColorBlendEquationEXT, MaxColorAttachments> equations;
+        equations.fill(VkColorBlendEquationEXT {
+            .srcColorBlendFactor = _blend.srcColorFactor,
+            .dstColorBlendFactor = _blend.dstColorFactor,
+            .colorBlendOp = _blend.colorOp,
+            .srcAlphaBlendFactor = _blend.srcAlphaFactor,
+            .dstAlphaBlendFactor = _blend.dstAlphaFactor,
+            .alphaBlendOp = _blend.alphaOp });
+        _dynamicStateFunctions->setColorBlendEquation(commandBuffer, 0, _colorAttachmentCount, equations.data());
+    }
+    if (_dynamicStates & PipelineDynamicStateColorWriteMask) {
+        std::array<VkColorComponentFlags, MaxColorAttachments> writeMasks;
+        writeMasks.fill(_blend.writeMask);
+        _dynamicStateFunctions->setColorWriteMask(commandBuffer, 0, _colorAttachmentCount, writeMasks.data());
+    }
+}
 
-    return vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &module) == VK_SUCCESS;
+void VulkanPipeline::release(VkDevice device)
+{
+    if (_pipeline && _ownsPipeline) {
+        vkDestroyPipeline(device, _pipeline, nullptr);
+    }
+    _pipeline = nullptr;
 }
 
 }
\ No newline at end of file
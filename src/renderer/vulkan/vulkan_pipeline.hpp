@@ -2,35 +2,161 @@
 
 #include "misc/types.hpp"
 #include "vulkan/vulkan_core.h"
-#include <filesystem>
+#include <cstdint>
 #include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_shader_reflection.hpp>
+#include <type_traits>
+#include <vector>
 
 namespace TBD {
 
+struct SpecializationConstant {
+    uint32_t id;
+    uint32_t value;
+
+    bool operator==(const SpecializationConstant&) const = default;
+};
+
+// Shaders are the reflected tables generated at build time, see shaders/shaders.hpp
 struct PipelineShaderData {
-    std::filesystem::path computeShaderPath;
-    std::filesystem::path vertexShaderPath;
-    std::filesystem::path fragmentShaderPath;
+    const ShaderReflection* computeShader = nullptr;
+    const ShaderReflection* vertexShader = nullptr;
+    const ShaderReflection* fragmentShader = nullptr;
+
+    // Applied to every stage, ids unused by a stage are ignored
+    std::vector<SpecializationConstant> specializationConstants;
+
+    // Compute only, specializes the workgroup size when the shader allows it, 0 keeps the reflected default
+    Vec3u workgroupSize { 0 };
+
+    bool operator==(const PipelineShaderData&) const = default;
+};
+
+struct PipelineRasterState {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    bool operator==(const PipelineRasterState&) const = default;
+};
+
+struct PipelineDepthState {
+    bool testEnable = true;
+    bool writeEnable = true;
+    VkCompareOp compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    bool operator==(const PipelineDepthState&) const = default;
+};
+
+// Applied to every color attachment of the pipeline
+struct PipelineBlendState {
+    bool enable = false;
+    VkBlendFactor srcColorFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstColorFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp colorOp = VK_BLEND_OP_ADD;
+    VkBlendFactor srcAlphaFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstAlphaFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp alphaOp = VK_BLEND_OP_ADD;
+    VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    bool operator==(const PipelineBlendState&) const = default;
+};
+
+// States recorded in the command buffer at draw time instead of being baked in the VkPipeline,
+// pipelines only differing by these states share the same VkPipeline
+enum PipelineDynamicStateBits : uint32_t {
+    PipelineDynamicStateCullMode = 1 << 0,
+    PipelineDynamicStateFrontFace = 1 << 1,
+    PipelineDynamicStateTopology = 1 << 2, // Within a topology class (points, lines, triangles, patches)
+    PipelineDynamicStateTopologyUnrestricted = 1 << 3, // Across topology classes
+    PipelineDynamicStateDepthTestEnable = 1 << 4,
+    PipelineDynamicStateDepthWriteEnable = 1 << 5,
+    PipelineDynamicStateDepthCompareOp = 1 << 6,
+    PipelineDynamicStatePolygonMode = 1 << 7,
+    PipelineDynamicStateBlendEnable = 1 << 8,
+    PipelineDynamicStateBlendEquation = 1 << 9,
+    PipelineDynamicStateColorWriteMask = 1 << 10,
+};
+using PipelineDynamicStateFlags = uint32_t;
+
+// VK_EXT_extended_dynamic_state3 entry points, not exported by the loader
+struct PipelineDynamicStateFunctions {
+    PFN_vkCmdSetPolygonModeEXT setPolygonMode = nullptr;
+    PFN_vkCmdSetColorBlendEnableEXT setColorBlendEnable = nullptr;
+    PFN_vkCmdSetColorBlendEquationEXT setColorBlendEquation = nullptr;
+    PFN_vkCmdSetColorWriteMaskEXT setColorWriteMask = nullptr;
+};
+
+// Full description of a pipeline state object, the fixed function state is ignored for compute pipelines
+struct PipelineDesc {
+    PipelineShaderData shaders;
+    PipelineRasterState raster;
+    PipelineDepthState depth;
+    PipelineBlendState blend;
     std::vector<VkFormat> colorAttachmentFormats;
-    VkFormat depthAttachmentFormat;
-    VkFormat stencilAttachmentFormat;
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+    VkFormat stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+    [[nodiscard]] inline bool isCompute() const { return shaders.computeShader != nullptr; }
+
+    // Reflected ranges of all the stages merged into a single range visible to every stage using push constants, size is 0 without push constants
+    [[nodiscard]] VkPushConstantRange getPushConstantRange() const;
+
+    // Stable across runs and platforms, only depends on the values of the description
+    [[nodiscard]] uint64_t hash() const;
+
+    // Copy with the dynamic states reset to their defaults, the description the VkPipeline is actually created from
+    [[nodiscard]] PipelineDesc getStaticDesc(PipelineDynamicStateFlags dynamicStates) const;
+
+    bool operator==(const PipelineDesc&) const = default;
+};
+
+struct PipelineShaderModules {
+    VkShaderModule compute = nullptr;
+    VkShaderModule vertex = nullptr;
+    VkShaderModule fragment = nullptr;
 };
 
 class VulkanPipeline {
     TBD_NO_COPY_MOVE(VulkanPipeline)
 public:
-    VulkanPipeline(VkDevice device, VkDescriptorSetLayout layout, const PipelineShaderData& data);
+    // The layout and shader modules are owned by the caller, usually the VulkanPipelineCache
+    VulkanPipeline(VkDevice device, VkPipelineCache cache, VkPipelineLayout layout, const PipelineShaderModules& modules, const PipelineDesc& desc,
+        PipelineDynamicStateFlags dynamicStates = 0, const PipelineDynamicStateFunctions* dynamicStateFunctions = nullptr);
+
+    // Shares the VkPipeline of base, desc must only differ from base by dynamic states (see canShare), base keeps the ownership
+    VulkanPipeline(const VulkanPipeline& base, const PipelineDesc& desc);
+
+    // True when desc has the same static description as this pipeline, a variant of it can then be created for desc
+    [[nodiscard]] bool canShare(const PipelineDesc& desc) const;
 
-    void dispatch(VkCommandBuffer commandBuffer, Vec3i kernelSize);
+    // The group count is derived from the workgroup size the pipeline was specialized with
+    void dispatch(VkCommandBuffer commandBuffer, Vec3u invocationCount);
 
     void draw(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<VkRenderingAttachmentInfo>& colorAttachments, VkRenderingAttachmentInfo depthAttachment = {}, VkRenderingAttachmentInfo stencilAttachment = {});
 
+    // Split draw, for several vkCmdDraw in the same rendering with the viewport, scissor and dynamic states set once
+    void beginRendering(VkCommandBuffer commandBuffer, VkExtent2D extent, const std::vector<VkRenderingAttachmentInfo>& colorAttachments, VkRenderingAttachmentInfo depthAttachment = {}, VkRenderingAttachmentInfo stencilAttachment = {});
+
+    void endRendering(VkCommandBuffer commandBuffer);
+
+    // Parameters are visible to every stage declaring a push constant block, offset is in bytes from the start of the block
+    template <typename T>
+    void pushConstants(VkCommandBuffer commandBuffer, const T& constants, uint32_t offset = 0) const;
+
     [[nodiscard]]
     VkPipelineLayout getLayout() const
     {
         return _pipelineLayout;
     }
 
+    [[nodiscard]]
+    Vec3u getWorkgroupSize() const
+    {
+        return _workgroupSize;
+    }
+
     [[nodiscard]]
     bool isValid() const
     {
@@ -40,13 +166,36 @@ public:
     void release(VkDevice device);
 
 private:
-    bool loadShader(VkDevice device, const std::filesystem::path& path, VkShaderModule& module) const;
+    void setDynamicStates(VkCommandBuffer commandBuffer) const;
 
 private:
     VkPipeline _pipeline = nullptr;
     VkPipelineLayout _pipelineLayout;
+    bool _ownsPipeline = true;
 
-    std::vector<VkShaderModule> _shaderModules;
+    VkPushConstantRange _pushConstantRange {};
+
+    Vec3u _workgroupSize { 1 };
+
+    // Description the VkPipeline was created from
+    PipelineDesc _staticDesc;
+
+    // Values of the dynamic states set at draw time
+    PipelineDynamicStateFlags _dynamicStates = 0;
+    const PipelineDynamicStateFunctions* _dynamicStateFunctions = nullptr;
+    PipelineRasterState _raster;
+    PipelineDepthState _depth;
+    PipelineBlendState _blend;
+    uint32_t _colorAttachmentCount = 0;
 };
 
-}
\ No newline at end of file
+template <typename T>
+void VulkanPipeline::pushConstants(VkCommandBuffer commandBuffer, const T& constants, uint32_t offset) const
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Push constants are copied as raw bytes");
+    TBD_ASSERT(offset + sizeof(T) <= _pushConstantRange.size, "Push constants out of the pipeline range");
+
+    vkCmdPushConstants(commandBuffer, _pipelineLayout, _pushConstantRange.stageFlags, _pushConstantRange.offset + offset, sizeof(T), &constants);
+}
+
+}
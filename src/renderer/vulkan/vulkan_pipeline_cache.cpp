@@ -0,0 +1,226 @@
+#include "vulkan_pipeline_cache.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_utils.hpp>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+VulkanPipelineCache::VulkanPipelineCache(VkDevice device)
+{
+    VkPipelineCacheCreateInfo cacheCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO
+    };
+
+    if (vkCreatePipelineCache(device, &cacheCreateInfo, nullptr, &_vkCache) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to create Vulkan pipeline cache");
+    }
+}
+
+VulkanPipelineCache::VulkanPipelineCache(VkDevice device, const VKUtils::DeviceCapabilities& capabilities)
+    : VulkanPipelineCache { device }
+{
+    if (capabilities.extendedDynamicState) {
+        _dynamicStates |= PipelineDynamicStateCullMode | PipelineDynamicStateFrontFace | PipelineDynamicStateTopology
+            | PipelineDynamicStateDepthTestEnable | PipelineDynamicStateDepthWriteEnable | PipelineDynamicStateDepthCompareOp;
+
+        if (capabilities.dynamicPrimitiveTopologyUnrestricted) {
+            _dynamicStates |= PipelineDynamicStateTopologyUnrestricted;
+        }
+    }
+
+    if (capabilities.extendedDynamicState3) {
+        auto loadFunction = [this, device]<typename T>(T& function, const char* name, bool supported, PipelineDynamicStateBits flag) {
+            if (supported) {
+                function = reinterpret_cast<T>(vkGetDeviceProcAddr(device, name));
+                _dynamicStates |= function != nullptr ? flag : 0u;
+            }
+        };
+
+        loadFunction(_dynamicStateFunctions.setPolygonMode, "vkCmdSetPolygonModeEXT", capabilities.extendedDynamicState3PolygonMode, PipelineDynamicStatePolygonMode);
+        loadFunction(_dynamicStateFunctions.setColorBlendEnable, "vkCmdSetColorBlendEnableEXT", capabilities.extendedDynamicState3ColorBlendEnable, PipelineDynamicStateBlendEnable);
+        loadFunction(_dynamicStateFunctions.setColorBlendEquation, "vkCmdSetColorBlendEquationEXT", capabilities.extendedDynamicState3ColorBlendEquation, PipelineDynamicStateBlendEquation);
+        loadFunction(_dynamicStateFunctions.setColorWriteMask, "vkCmdSetColorWriteMaskEXT", capabilities.extendedDynamicState3ColorWriteMask, PipelineDynamicStateColorWriteMask);
+    }
+
+    TBD_DEBUG("Pipeline dynamic states 0x" << std::hex << _dynamicStates << std::dec);
+}
+
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+    TBD_ASSERT(_vkCache == nullptr, "Vulkan pipeline cache was not cleaned up");
+}
+
+VulkanPipeline* VulkanPipelineCache::getPipeline(VkDevice device, const PipelineDesc& desc, VkDescriptorSetLayout setLayout)
+{
+    ++_stats.pipelineRequests;
+
+    PipelineKey key { desc, setLayout };
+    if (auto it = _pipelines.find(key); it != _pipelines.end()) {
+        ++_stats.pipelineHits;
+        return it->second.get();
+    }
+
+    PipelineKey staticKey { desc.getStaticDesc(_dynamicStates), setLayout };
+    auto it = _vkPipelines.find(staticKey);
+    if (it == _vkPipelines.end()) {
+        Uptr<VulkanPipeline> vkPipeline = createPipeline(device, staticKey.desc, setLayout);
+        it = _vkPipelines.emplace(std::move(staticKey), std::move(vkPipeline)).first;
+        _stats.vkPipelineCount = static_cast<uint32_t>(_vkPipelines.size());
+    }
+
+    // A description that can't share the VkPipeline gets its own rather than the wrong state
+    Uptr<VulkanPipeline> pipeline = it->second->canShare(desc) ? std::make_unique<VulkanPipeline>(*it->second, desc) : createPipeline(device, desc, setLayout);
+    VulkanPipeline* result = pipeline.get();
+
+    _pipelines.emplace(std::move(key), std::move(pipeline));
+    _stats.pipelineCount = static_cast<uint32_t>(_pipelines.size());
+
+    return result;
+}
+
+Uptr<VulkanPipeline> VulkanPipelineCache::createPipeline(VkDevice device, const PipelineDesc& desc, VkDescriptorSetLayout setLayout)
+{
+    TBD_PROFILE_FUNCTION();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    PipelineShaderModules modules {};
+    if (desc.isCompute()) {
+        modules.compute = getShaderModule(device, *desc.shaders.computeShader);
+    } else if (desc.shaders.vertexShader != nullptr && desc.shaders.fragmentShader != nullptr) {
+        modules.vertex = getShaderModule(device, *desc.shaders.vertexShader);
+        modules.fragment = getShaderModule(device, *desc.shaders.fragmentShader);
+    } else {
+        TBD_ABORT_VK("mandatory vulkan shader missing");
+    }
+
+    auto pipeline = std::make_unique<VulkanPipeline>(device, _vkCache, getPipelineLayout(device, setLayout, desc.getPushConstantRange()), modules, desc, _dynamicStates, &_dynamicStateFunctions);
+    _stats.creationTimeMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    TBD_DEBUG("Pipeline 0x" << std::hex << desc.hash() << std::dec << " created");
+
+    return pipeline;
+}
+
+void VulkanPipelineCache::release(VkDevice device)
+{
+    for (auto& [key, pipeline] : _pipelines) {
+        pipeline->release(device);
+    }
+    _pipelines.clear();
+
+    for (auto& [key, pipeline] : _vkPipelines) {
+        pipeline->release(device);
+    }
+    _vkPipelines.clear();
+
+    for (auto& [key, layout] : _layouts) {
+        vkDestroyPipelineLayout(device, layout, nullptr);
+    }
+    _layouts.clear();
+
+    for (auto [shader, module] : _shaderModules) {
+        vkDestroyShaderModule(device, module, nullptr);
+    }
+    _shaderModules.clear();
+
+    if (_vkCache) {
+        vkDestroyPipelineCache(device, _vkCache, nullptr);
+        _vkCache = nullptr;
+    }
+}
+
+VkShaderModule VulkanPipelineCache::getShaderModule(VkDevice device, const ShaderReflection& shader)
+{
+    ++_stats.shaderModuleRequests;
+
+    if (auto it = _shaderModules.find(&shader); it != _shaderModules.end()) {
+        return it->second;
+    }
+
+    VkShaderModule module;
+    if (!shader.code.empty()) {
+        VkShaderModuleCreateInfo moduleCreateInfo {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .codeSize = shader.code.size_bytes(),
+            .pCode = shader.code.data()
+        };
+
+        if (vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &module) != VK_SUCCESS) {
+            TBD_ABORT_VK("Failed to create shader module for \"" << shader.name << "\"");
+        }
+    } else if (!loadShader(device, shader.spirvPath, module)) {
+        TBD_ABORT_VK("Failed to load shader \"" << shader.name << "\"");
+    }
+
+    _shaderModules.emplace(&shader, module);
+    _stats.shaderModuleCount = static_cast<uint32_t>(_shaderModules.size());
+
+    return module;
+}
+
+VkPipelineLayout VulkanPipelineCache::getPipelineLayout(VkDevice device, VkDescriptorSetLayout setLayout, VkPushConstantRange pushConstantRange)
+{
+    ++_stats.layoutRequests;
+
+    const LayoutKey key { setLayout, pushConstantRange.stageFlags, pushConstantRange.offset, pushConstantRange.size };
+    if (auto it = _layouts.find(key); it != _layouts.end()) {
+        return it->second;
+    }
+
+    VkPipelineLayoutCreateInfo layoutCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = setLayout != nullptr ? 1u : 0u,
+        .pSetLayouts = &setLayout,
+        .pushConstantRangeCount = pushConstantRange.size != 0 ? 1u : 0u,
+        .pPushConstantRanges = &pushConstantRange
+    };
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device, &layoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to create the pipeline layout");
+    }
+
+    _layouts.emplace(key, layout);
+    _stats.layoutCount = static_cast<uint32_t>(_layouts.size());
+
+    return layout;
+}
+
+bool VulkanPipelineCache::loadShader(VkDevice device, const std::filesystem::path& path, VkShaderModule& module) const
+{
+    if (!path.has_filename() || !std::filesystem::exists(path)) {
+        TBD_WARN("Shader at \"" << path << "\" does not exist");
+        return false;
+    }
+
+    std::ifstream file { path, std::ios::ate | std::ios::binary };
+    if (!file.is_open()) {
+        TBD_WARN("Failed to open shader at \"" << path << "\"");
+        return false;
+    }
+
+    size_t size = file.tellg();
+    file.seekg(0);
+
+    std::vector<char> buffer(size);
+    file.read(buffer.data(), size);
+    file.close();
+
+    VkShaderModuleCreateInfo moduleCreateInfo {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = size,
+        .pCode = reinterpret_cast<uint32_t*>(buffer.data())
+    };
+
+    return vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &module) == VK_SUCCESS;
+}
+
+}
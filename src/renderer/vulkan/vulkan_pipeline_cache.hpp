@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <misc/types.hpp>
+#include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_pipeline.hpp>
+#include <unordered_map>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+struct PipelineCacheStats {
+    uint32_t pipelineRequests = 0;
+    uint32_t pipelineHits = 0;
+    uint32_t pipelineCount = 0;
+
+    // Distinct VkPipeline objects, lower than pipelineCount when pipelines only differ by dynamic states
+    uint32_t vkPipelineCount = 0;
+
+    uint32_t layoutRequests = 0;
+    uint32_t layoutCount = 0;
+
+    uint32_t shaderModuleRequests = 0;
+    uint32_t shaderModuleCount = 0;
+
+    // Time spent in shader loading and pipeline compilation
+    float creationTimeMs = 0.f;
+};
+
+namespace VKUtils {
+    struct DeviceCapabilities;
+}
+
+// Dedupes pipelines by description, pipeline layouts and shader modules are shared between the pipelines
+class VulkanPipelineCache {
+    TBD_NO_COPY_MOVE(VulkanPipelineCache)
+public:
+    VulkanPipelineCache() = delete;
+
+    // Without capabilities every state is baked in the pipelines
+    VulkanPipelineCache(VkDevice device);
+
+    // States the device can set dynamically are moved out of the pipelines, collapsing the permutations
+    VulkanPipelineCache(VkDevice device, const VKUtils::DeviceCapabilities& capabilities);
+
+    ~VulkanPipelineCache();
+
+    // The returned pipeline stays valid until the cache is released
+    [[nodiscard]] VulkanPipeline* getPipeline(VkDevice device, const PipelineDesc& desc, VkDescriptorSetLayout setLayout = nullptr);
+
+    [[nodiscard]] inline const PipelineCacheStats& getStats() const { return _stats; }
+
+    [[nodiscard]] inline PipelineDynamicStateFlags getDynamicStates() const { return _dynamicStates; }
+
+    void release(VkDevice device);
+
+private:
+    [[nodiscard]] Uptr<VulkanPipeline> createPipeline(VkDevice device, const PipelineDesc& desc, VkDescriptorSetLayout setLayout);
+
+    [[nodiscard]] VkShaderModule getShaderModule(VkDevice device, const ShaderReflection& shader);
+
+    [[nodiscard]] VkPipelineLayout getPipelineLayout(VkDevice device, VkDescriptorSetLayout setLayout, VkPushConstantRange pushConstantRange);
+
+    // Fallback for builds without embedded shader binaries
+    [[nodiscard]] bool loadShader(VkDevice device, const std::filesystem::path& path, VkShaderModule& module) const;
+
+private:
+    struct PipelineKey {
+        PipelineDesc desc;
+        VkDescriptorSetLayout setLayout;
+
+        bool operator==(const PipelineKey&) const = default;
+    };
+
+    struct PipelineKeyHasher {
+        inline size_t operator()(const PipelineKey& key) const { return key.desc.hash() ^ std::hash<VkDescriptorSetLayout> {}(key.setLayout); }
+    };
+
+    struct LayoutKey {
+        VkDescriptorSetLayout setLayout;
+        VkShaderStageFlags pushConstantStages;
+        uint32_t pushConstantOffset;
+        uint32_t pushConstantSize;
+
+        bool operator==(const LayoutKey&) const = default;
+    };
+
+    struct LayoutKeyHasher {
+        inline size_t operator()(const LayoutKey& key) const
+        {
+            return std::hash<VkDescriptorSetLayout> {}(key.setLayout) ^ (size_t(key.pushConstantStages) << 1) ^ (size_t(key.pushConstantOffset) << 8) ^ (size_t(key.pushConstantSize) << 16);
+        }
+    };
+
+    VkPipelineCache _vkCache = nullptr;
+
+    PipelineDynamicStateFlags _dynamicStates = 0;
+    PipelineDynamicStateFunctions _dynamicStateFunctions;
+
+    // Keyed by the static description, own the VkPipeline objects
+    std::unordered_map<PipelineKey, Uptr<VulkanPipeline>, PipelineKeyHasher> _vkPipelines;
+    // Keyed by the full description, share the VkPipeline of their static description
+    std::unordered_map<PipelineKey, Uptr<VulkanPipeline>, PipelineKeyHasher> _pipelines;
+    std::unordered_map<LayoutKey, VkPipelineLayout, LayoutKeyHasher> _layouts;
+    std::unordered_map<const ShaderReflection*, VkShaderModule> _shaderModules;
+
+    PipelineCacheStats _stats;
+};
+
+}
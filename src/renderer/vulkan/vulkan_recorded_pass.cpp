@@ -0,0 +1,51 @@
+#include "vulkan_recorded_pass.hpp"
+#include <utility>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+VulkanRecordedPass::VulkanRecordedPass(VkCommandBuffer commandBuffer, RecordedPassStats* stats, VkQueryPipelineStatisticFlags inheritedStatistics)
+    : _commandBuffer { commandBuffer }
+    , _stats { stats }
+    , _inheritedStatistics { inheritedStatistics }
+{
+}
+
+VulkanRecordedPass::VulkanRecordedPass(VulkanRecordedPass&& other)
+    : _commandBuffer { other._commandBuffer }
+    , _stats { other._stats }
+    , _inheritedStatistics { other._inheritedStatistics }
+    , _inputs { std::move(other._inputs) }
+{
+    other._commandBuffer = nullptr;
+}
+
+void VulkanRecordedPass::begin()
+{
+    // Only used outside of render passes, only the queries they may run in are inherited
+    VkCommandBufferInheritanceInfo inheritanceInfo {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pipelineStatistics = _inheritedStatistics
+    };
+
+    VkCommandBufferBeginInfo beginInfo {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pInheritanceInfo = &inheritanceInfo
+    };
+
+    // Begin implicitly resets the command buffer
+    if (vkBeginCommandBuffer(_commandBuffer, &beginInfo) != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to begin a secondary command buffer");
+    }
+}
+
+void VulkanRecordedPass::replay(VkCommandBuffer commandBuffer)
+{
+    vkCmdExecuteCommands(commandBuffer, 1, &_commandBuffer);
+
+    if (_stats) {
+        ++_stats->replayCount;
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <misc/utils.hpp>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+struct RecordedPassStats {
+    uint32_t recordCount = 0;
+    uint32_t replayCount = 0;
+};
+
+// Secondary command buffer recorded once and replayed every frame, recorded again only when its inputs change.
+// It must not be pending execution when recorded again, passes are owned by a single frame in flight
+class VulkanRecordedPass {
+    TBD_NO_COPY(VulkanRecordedPass)
+public:
+    VulkanRecordedPass() = delete;
+
+    // The command buffer must be a secondary one from a pool created with VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+    // replays inside pipeline statistics queries must inherit their flags, which requires the inheritedQueries feature
+    VulkanRecordedPass(VkCommandBuffer commandBuffer, RecordedPassStats* stats = nullptr, VkQueryPipelineStatisticFlags inheritedStatistics = 0);
+
+    VulkanRecordedPass(VulkanRecordedPass&& other);
+
+    // Inputs hold everything the recorded commands depend on, image views, extents, pipelines, and are compared bytewise
+    template <typename Inputs, typename RecordFunction>
+    void execute(VkCommandBuffer commandBuffer, const Inputs& inputs, RecordFunction&& record);
+
+    inline void invalidate() { _inputs.clear(); }
+
+private:
+    void begin();
+
+    void replay(VkCommandBuffer commandBuffer);
+
+private:
+    VkCommandBuffer _commandBuffer;
+    RecordedPassStats* _stats;
+    VkQueryPipelineStatisticFlags _inheritedStatistics;
+    std::vector<std::byte> _inputs;
+};
+
+template <typename Inputs, typename RecordFunction>
+void VulkanRecordedPass::execute(VkCommandBuffer commandBuffer, const Inputs& inputs, RecordFunction&& record)
+{
+    static_assert(std::has_unique_object_representations_v<Inputs>, "Padding bytes would make the inputs comparison unreliable");
+
+    const std::byte* inputBytes = reinterpret_cast<const std::byte*>(&inputs);
+    if (_inputs.size() != sizeof(Inputs) || std::memcmp(_inputs.data(), inputBytes, sizeof(Inputs)) != 0) {
+        _inputs.assign(inputBytes, inputBytes + sizeof(Inputs));
+
+        begin();
+        record(_commandBuffer);
+        if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS) {
+            TBD_ABORT_VK("Failed to record a secondary command buffer");
+        }
+
+        if (_stats) {
+            ++_stats->recordCount;
+        }
+    }
+
+    replay(commandBuffer);
+}
+
+}
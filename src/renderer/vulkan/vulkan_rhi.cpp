@@ -1,14 +1,30 @@
 #include "vulkan_rhi.hpp"
 #include "vulkan_utils.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <general/config.hpp>
+#include <general/startup_trace.hpp>
 #include <general/window.hpp>
-#include <initializer_list>
+#include <iomanip>
 #include <memory>
 #include <misc/utils.hpp>
+#include <renderer/core/workload_frame.hpp>
 #include <renderer/vulkan/vulkan_descriptor_set_pool.hpp>
+#include <renderer/vulkan/vulkan_hud.hpp>
 #include <renderer/vulkan/vulkan_pipeline.hpp>
+#include <renderer/vulkan/vulkan_pipeline_cache.hpp>
 #include <renderer/vulkan/vulkan_texture.hpp>
+#include <renderer/vulkan/vulkan_workgroup_profile.hpp>
+#include <shaders/shaders.hpp>
+#include <span>
+#include <sstream>
+#include <string_view>
 #include <sys/types.h>
 #include <vulkan/vulkan_core.h>
 #define VMA_IMPLEMENTATION
@@ -16,108 +32,434 @@
 
 namespace TBD {
 
-VulkanRHI::VulkanRHI(const Window& Window)
+namespace {
+
+    // Mirrors of the shaders push constant blocks
+    struct GradientConstants {
+        Vec2i resolution;
+    };
+    static_assert(sizeof(GradientConstants) == Shaders::GradientComp.pushConstantRanges[0].size);
+
+    struct TriangleConstants {
+        Mat4 transform;
+    };
+    static_assert(sizeof(TriangleConstants) == Shaders::TriangleVert.pushConstantRanges[0].size);
+
+    constexpr std::string_view FramePass = "Frame";
+
+    // HDR intermediate the frames render to before the blit to the swapchain
+    constexpr VkFormat RenderTargetFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    constexpr VkImageUsageFlags RenderTargetUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    constexpr VkFormat OffscreenImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    constexpr VkImageUsageFlags OffscreenImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+    constexpr VkFormat StreamedTextureFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    constexpr VkImageUsageFlags StreamedTextureUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    // The first frames are slowed down by lazy driver work, they are never captured as the slowest
+    constexpr uint32_t FrameCaptureWarmup = 10;
+
+    // Everything the recorded passes depend on, they are recorded again when any of it changes
+    struct GradientPassInputs {
+        VkImageView view;
+        const VulkanPipeline* pipeline;
+        VkExtent2D extent;
+    };
+
+    struct BlitPassInputs {
+        VkImage src;
+        VkImage dst;
+        VkExtent2D srcExtent;
+        VkExtent2D dstExtent;
+    };
+
+    [[nodiscard]] float getElapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Cell index of a square grid covering the render target, the whole target for a single cell
+    Mat4 getGridTransform(uint32_t index, uint32_t count)
+    {
+        const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(float(count))));
+        const float cellSize = 2.f / float(side);
+
+        Mat4 transform { 1.f };
+        transform[0][0] = 1.f / float(side);
+        transform[1][1] = 1.f / float(side);
+        transform[3][0] = -1.f + cellSize * (float(index % side) + 0.5f);
+        transform[3][1] = -1.f + cellSize * (float(index / side) + 0.5f);
+        return transform;
+    }
+
+    // Successive dispatches writing the same image
+    void insertComputeBarrier(VkCommandBuffer commandBuffer)
+    {
+        VkMemoryBarrier2 barrier {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+        };
+        VkDependencyInfo dependencyInfo {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &barrier
+        };
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+
+    VkPresentModeKHR toVkPresentMode(PresentMode mode)
+    {
+        switch (mode) {
+        case PresentMode::FifoRelaxed:
+            return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        case PresentMode::Mailbox:
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        case PresentMode::Immediate:
+            return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        default:
+            return VK_PRESENT_MODE_FIFO_KHR;
+        }
+    }
+
+    // Names of the --present-mode values
+    const char* toString(VkPresentModeKHR mode)
+    {
+        switch (mode) {
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "fifo-relaxed";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "mailbox";
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "immediate";
+        default:
+            return "unknown";
+        }
+    }
+
+}
+
+VulkanRHI::VulkanRHI(const Window* window, const RendererConfig& config, StartupTrace* trace)
     : IRHI {}
+    , _window { window }
+    , _memoryStatsPath { config.memoryStatsPath }
+    , _headless { window == nullptr }
+    , _headlessExtent { config.width, config.height }
+    , _captureDirectory { _headless ? config.captureDirectory : std::filesystem::path {} }
+    , _framesInFlight { config.framesInFlight }
+    , _dynamicResolution { config.dynamicResolution }
+    , _workload { config.workload }
+    , _frameCapturePath { config.frameCapturePath }
+    , _frameCaptureId { config.frameCaptureId }
+    , _lowLatency { config.lowLatency }
 {
-    _instance = VKUtils::createVkInstance(Window.requiredVulkanExtensions());
+    TBD_ASSERT(_framesInFlight >= RendererConfig::MinFramesInFlight && _framesInFlight <= RendererConfig::MaxFramesInFlight, "Unsupported frames in flight count");
+
+    TBD_ASSERT(_headless == config.headless, "Headless rendering requires no window");
+
+    {
+        StartupTrace::Scope scope { trace, "Vulkan instance" };
+
+        _instance = VKUtils::createVkInstance(_window != nullptr ? _window->requiredVulkanExtensions() : std::vector<const char*> {});
 
 #if PROJECT_DEBUG
-    _debugUtilsMessenger = VKUtils::createDebugMessenger(_instance);
+        _debugUtilsMessenger = VKUtils::createDebugMessenger(_instance);
 #endif
 
-    _surface = Window.createVkSurface(_instance);
+        if (!_headless) {
+            _surface = _window->createVkSurface(_instance);
+        }
+    }
 
-    auto [gpu, queues] = VKUtils::selectPhysicalDevice(_instance, _surface);
-    _gpu = gpu;
+    VKUtils::DeviceCapabilities capabilities;
+    {
+        StartupTrace::Scope scope { trace, "Device selection" };
 
-    _device = createLogicalDevice(_gpu, queues);
-    _allocator = VKUtils::createVMAAllocator(_instance, _gpu, _device);
+        auto [gpu, queues] = VKUtils::selectPhysicalDevice(_instance, _surface, config.device);
+        _gpu = gpu;
+        _queues = queues;
 
-    vkGetDeviceQueue(_device, queues.GraphicsQueueFamilyID, 0, &_graphicsQueue);
-    vkGetDeviceQueue(_device, queues.PresentQueueFamilyID, 0, &_presentQueue);
+        capabilities = VKUtils::queryDeviceCapabilities(_gpu);
+        VKUtils::logDeviceCapabilities(capabilities);
+        _deviceName = capabilities.name;
+    }
 
-    // The extent provided should match the surface, hopefully glfw
-    auto [swapchain, surfaceFormat] = createSwapchain(_device, _gpu, _surface, queues, { Window.getWidth(), Window.getHeight() });
-    _swapchain = swapchain;
+    {
+        StartupTrace::Scope scope { trace, "Device creation" };
 
-    uint32_t swapchainImageCount;
-    vkGetSwapchainImagesKHR(_device, _swapchain, &swapchainImageCount, nullptr);
+        _device = createLogicalDevice(_gpu, _queues, capabilities, !_headless);
+        _allocator = VKUtils::createVMAAllocator(_instance, _gpu, _device, capabilities);
+        _memoryTracker = std::make_unique<VulkanMemoryTracker>(_allocator);
 
-    std::vector<VkImage> swapchainImages;
-    swapchainImages.resize(swapchainImageCount);
-    _swapchainTextures.resize(swapchainImageCount);
-    vkGetSwapchainImagesKHR(_device, _swapchain, &swapchainImageCount, swapchainImages.data());
+        vkGetDeviceQueue(_device, _queues.GraphicsQueueFamilyID, 0, &_graphicsQueue);
+        vkGetDeviceQueue(_device, _queues.PresentQueueFamilyID, 0, &_presentQueue);
+    }
+
+    if (_lowLatency) {
+        if (capabilities.presentWait && !_headless) {
+            _waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(_device, "vkWaitForPresentKHR"));
+        }
+        _frameStartTimes.resize(_framesInFlight);
+        _latencyStats.measuredAtPresent = _waitForPresent != nullptr;
 
-    for (int i = 0; i < swapchainImageCount; ++i) {
-        RID rid = _textures.allocate(this, swapchainImages[i], surfaceFormat, VkExtent3D { Window.getWidth(), Window.getHeight(), 1 }, VK_IMAGE_ASPECT_COLOR_BIT);
-        _swapchainTextures[i] = &_textures.getResource(rid);
+        TBD_LOG("Low latency mode using " << (_waitForPresent != nullptr ? "present wait" : "GPU completion"));
     }
 
-    _commandPool = VKUtils::createCommandPool(_device, queues.GraphicsQueueFamilyID);
+    if (config.directOutput) {
+        if (_headless) {
+            TBD_WARN("Direct output requires a swapchain, rendering through the HDR intermediate");
+        } else if (config.dynamicResolution.enabled) {
+            TBD_WARN("Direct output is incompatible with dynamic resolution, rendering through the HDR intermediate");
+        } else if (!capabilities.storageImageWriteWithoutFormat || !VKUtils::supportsStorageSwapchain(_gpu, _surface)) {
+            TBD_WARN("Swapchain images can't be used as storage, rendering through the HDR intermediate");
+        } else {
+            _directOutput = true;
+            TBD_LOG("Rendering directly to the swapchain");
+        }
+    }
 
-    VKUtils::allocateCommandBuffers(_device, _commandPool, MaxFramesInFlight, _commandBuffers.data());
+    _descriptorSetPoolCompute = std::make_unique<VulkanDescriptorSetPool>(_device,
+        _framesInFlight,
+        Shaders::GradientComp.stage,
+        Shaders::GradientComp.bindings,
+        1000);
 
-    _renderSemaphores.resize(swapchainImageCount);
-    for (uint32_t i = 0; i < _renderSemaphores.size(); ++i) {
-        _renderSemaphores[i] = VKUtils::createSemaphore(_device);
+    _pipelineCache = std::make_unique<VulkanPipelineCache>(_device, capabilities);
+
+    // Pipelines only depend on the device and the attachment format, shader modules and pipelines are compiled
+    // on a worker while the swapchain and the frame resources are created, the pipeline cache is only used from there until the join
+    const VkFormat colorFormat = _directOutput ? VKUtils::selectSurfaceFormat(_gpu, _surface, true) : RenderTargetFormat;
+    std::future<void> pipelines = std::async(std::launch::async, [this, trace, colorFormat]() {
+        TBD_PROFILE_THREAD("Pipeline compilation");
+        StartupTrace::Scope scope { trace, "Pipelines" };
+
+        VulkanWorkgroupProfile workgroupProfile;
+        workgroupProfile.load(VulkanWorkgroupProfile::getPath(_gpu));
+
+        // The direct variants share the bindings of the intermediate ones and encode sRGB themselves
+        const ShaderReflection& gradientShader = _directOutput ? Shaders::GradientDirectComp : Shaders::GradientComp;
+        _computePipeline = _pipelineCache->getPipeline(
+            _device,
+            PipelineDesc { .shaders {
+                .computeShader = &gradientShader,
+                .workgroupSize = workgroupProfile.getWorkgroupSize(gradientShader) } },
+            _descriptorSetPoolCompute->getLayout());
+
+        _graphicsPipeline = _pipelineCache->getPipeline(_device,
+            PipelineDesc {
+                .shaders {
+                    .vertexShader = &Shaders::TriangleVert,
+                    .fragmentShader = _directOutput ? &Shaders::TriangleDirectFrag : &Shaders::TriangleFrag },
+                .colorAttachmentFormats { colorFormat } });
+    });
+
+    {
+        StartupTrace::Scope scope { trace, "Swapchain" };
+
+        if (_headless) {
+            TBD_LOG("Headless rendering at " << _headlessExtent.width << "x" << _headlessExtent.height);
+            createOffscreenImages();
+        } else {
+            _presentMode = VKUtils::selectPresentMode(_gpu, _surface, toVkPresentMode(config.presentMode));
+            if (_presentMode != toVkPresentMode(config.presentMode)) {
+                TBD_WARN("Requested present mode " << toString(toVkPresentMode(config.presentMode)) << " is not supported by the surface, falling back to "
+                                                    << toString(_presentMode));
+            }
+
+            createSwapchain();
+        }
+    }
+
+    {
+        StartupTrace::Scope scope { trace, "Frame resources" };
+
+        _commandPools.resize(_framesInFlight);
+        _commandBuffers.resize(_framesInFlight);
+        for (uint32_t i = 0; i < _framesInFlight; ++i) {
+            _commandPools[i] = VKUtils::createCommandPool(_device, _queues.GraphicsQueueFamilyID, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+            VKUtils::allocateCommandBuffers(_device, _commandPools[i], 1, &_commandBuffers[i]);
+        }
+
+        _recordedPassPool = VKUtils::createCommandPool(_device, _queues.GraphicsQueueFamilyID);
+        _recordedPasses.resize(_framesInFlight);
+
+        _frameTimeline = VKUtils::createTimelineSemaphore(_device);
+        _frameScales.resize(_framesInFlight, _dynamicResolution.getScale());
+
+        if (!_headless) {
+            _presentSemaphores.resize(_framesInFlight);
+            for (uint32_t i = 0; i < _framesInFlight; ++i) {
+                _presentSemaphores[i] = VKUtils::createSemaphore(_device);
+            }
+        }
+
+        if (config.pipelineStatistics && !capabilities.pipelineStatisticsQuery) {
+            TBD_WARN("The device doesn't support pipeline statistics queries, only GPU times will be measured");
+        }
+        _gpuProfiler = std::make_unique<VulkanGpuProfiler>(_instance, _device, _gpu, _queues.GraphicsQueueFamilyID, _framesInFlight,
+            config.pipelineStatistics && capabilities.pipelineStatisticsQuery);
+
+        _gradientStatistics = _gpuProfiler->getPipelineStatisticFlags() != 0 && capabilities.inheritedQueries;
+        if (_gpuProfiler->getPipelineStatisticFlags() != 0 && !capabilities.inheritedQueries) {
+            TBD_WARN("The device doesn't support inherited queries, the gradient pass won't have pipeline statistics");
+        }
     }
 
-    for (uint32_t i = 0; i < MaxFramesInFlight; ++i) {
-        _presentSemaphores[i] = VKUtils::createSemaphore(_device);
-        _frameFences[i] = VKUtils::createFence(_device);
-        _renderTargets[i] = &_textures.getResource(
-            _textures.allocate(
-                this,
-                VK_FORMAT_R16G16B16A16_SFLOAT,
-                VkExtent3D { Window.getWidth(), Window.getHeight(), 1 },
-                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-                VK_IMAGE_ASPECT_COLOR_BIT));
+    {
+        StartupTrace::Scope scope { trace, "Render targets" };
+        createRenderTargets();
     }
 
-    _descriptorSetPoolCompute = std::make_unique<VulkanDescriptorSetPool<MaxFramesInFlight>>(_device,
-        VK_SHADER_STAGE_COMPUTE_BIT,
-        std::initializer_list<VkDescriptorType> { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
-        1000);
+#if TBD_HUD
+    if (config.hud && !_headless) {
+        StartupTrace::Scope scope { trace, "HUD" };
+        _hud = std::make_unique<VulkanHud>(_window->getGlfwWindow(), _instance, _gpu, _device, _queues.GraphicsQueueFamilyID, _graphicsQueue,
+            static_cast<uint32_t>(_swapchainTextures.size()), _swapchainTextures[0]->getFormat());
+    }
+#endif
+
+    if (_workload.streamedTextureSize != 0) {
+        const uint32_t size = _workload.streamedTextureSize;
+        VulkanTexture texture {
+            this,
+            StreamedTextureFormat,
+            VkExtent3D { size, size, 1 },
+            StreamedTextureUsage,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            MemoryCategory::StreamedTexture,
+            false
+        };
+        _streamedTexture = &_textures.getResource(_textures.allocate(this, std::move(texture)));
 
-    _computePipeline = std::make_unique<VulkanPipeline>(
-        _device,
-        _descriptorSetPoolCompute->getLayout(),
-        PipelineShaderData { .computeShaderPath = PROJECT_DIR "src/renderer/shaders/.cache/gradient.comp.spv" });
+        _streamingSource.resize(size_t(size) * size);
+        fillStreamingNoise(_streamingSource);
 
-    _graphicsPipeline = std::make_unique<VulkanPipeline>(_device,
-        nullptr,
-        PipelineShaderData {
-            .vertexShaderPath = PROJECT_DIR "src/renderer/shaders/.cache/triangle.vert.spv",
-            .fragmentShaderPath = PROJECT_DIR "src/renderer/shaders/.cache/triangle.frag.spv",
-            .colorAttachmentFormats { _renderTargets[0]->getFormat() } });
+        for (uint32_t i = 0; i < _framesInFlight; ++i) {
+            _streamingBuffers.emplace_back(this, 4 * size * size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryCategory::Staging);
+        }
+    }
+
+    if (_workload.drawCount != 1 || _workload.dispatchCount != 1 || _workload.streamedTextureSize != 0) {
+        TBD_LOG("Synthetic workload of " << _workload.drawCount << " draws, " << _workload.dispatchCount << " dispatches and a "
+                                         << _workload.streamedTextureSize << " texture streamed per frame");
+    }
+
+    if (config.dynamicResolution.enabled) {
+        TBD_LOG("Dynamic resolution between " << config.dynamicResolution.minScale << " and " << config.dynamicResolution.maxScale
+                                              << " scale for a " << config.dynamicResolution.targetFrameMs << "ms GPU budget");
+    }
+
+    {
+        StartupTrace::Scope scope { trace, "Pipelines join" };
+        pipelines.get();
+    }
 }
 
 VulkanRHI::~VulkanRHI()
 {
     vkDeviceWaitIdle(_device);
 
+    if (!_frameCapturePath.empty() && _frameCaptureId == 0) {
+        if (_frameCapture.frameId != 0) {
+            writeFrameCapture();
+        } else {
+            TBD_WARN("Not enough frames were rendered to capture the slowest one");
+        }
+    }
+
+    // Before anything is released, for the peak of the run
+    _memoryTracker->logStats();
+    if (!_memoryStatsPath.empty()) {
+        _memoryTracker->writeJson(_memoryStatsPath);
+    }
+
+    for (uint32_t i = 0; i < _captureBuffers.size(); ++i) {
+        writeCapture(i);
+        _captureBuffers[i].release(*this);
+    }
+    for (VulkanBuffer& buffer : _streamingBuffers) {
+        buffer.release(*this);
+    }
+
+    const PipelineCacheStats& pipelineStats = _pipelineCache->getStats();
+    TBD_LOG("Pipeline cache: " << pipelineStats.pipelineCount << " pipelines collapsed into " << pipelineStats.vkPipelineCount << " VkPipelines for " << pipelineStats.pipelineRequests << " requests, "
+                               << pipelineStats.layoutCount << " layouts, " << pipelineStats.shaderModuleCount << " shader modules, "
+                               << pipelineStats.creationTimeMs << "ms of creation");
+
+    if (_swapchainStats.recreationCount != 0) {
+        TBD_LOG("Swapchain recreated " << _swapchainStats.recreationCount << " times, " << _swapchainStats.maxRecreationMs << "ms max recreation, "
+                                       << _swapchainStats.maxResizeFrameMs << "ms max resize frame");
+    }
+
+    TBD_LOG("Recorded passes: " << _recordedPassStats.recordCount << " recordings for " << _recordedPassStats.replayCount << " replays");
+
+    if (_gpuFrameCount != 0) {
+        TBD_LOG("GPU frame time: " << _gpuFrameMsSum / _gpuFrameCount << "ms average over " << _gpuFrameCount << " frames at "
+                                   << _swapchainExtent.width << "x" << _swapchainExtent.height << (_directOutput ? " with direct output" : ""));
+    }
+
+    for (const GpuPassStats& pass : _gpuProfiler->getStats()) {
+        TBD_LOG("GPU pass " << pass.name << ": " << pass.averageMs << "ms average, " << pass.p50Ms << "ms p50, " << pass.p95Ms << "ms p95, "
+                            << pass.p99Ms << "ms p99, " << pass.maxMs << "ms max over the last " << pass.sampleCount << " frames");
+
+        if (pass.hasPipelineStatistics) {
+            // Compute invocations include the ones out of the dispatched range, to compare with the resolution
+            const GpuPipelineStatistics& statistics = pass.pipelineStatistics;
+            TBD_LOG("  " << statistics.vertexShaderInvocations << " vertex, " << statistics.fragmentShaderInvocations << " fragment, "
+                         << statistics.computeShaderInvocations << " compute invocations, " << statistics.clippingInvocations << " primitives clipped to "
+                         << statistics.clippingPrimitives << " on average");
+        }
+    }
+
+    if (_latencyStats.sampleCount != 0) {
+        TBD_LOG("Input to " << (_latencyStats.measuredAtPresent ? "photon" : "GPU completion") << " latency: " << _latencyStats.averageMs << "ms average, "
+                            << _latencyStats.maxMs << "ms max over " << _latencyStats.sampleCount << " frames");
+    }
+
+    _framePacing.logStats();
+
+    releaseRetiredResources(true);
+
+#if TBD_HUD
+    if (_hud) {
+        _hud->release(_device);
+    }
+#endif
+
     _descriptorSetPoolCompute->releasePool(_device);
-    _computePipeline->release(_device);
-    _graphicsPipeline->release(_device);
+    _pipelineCache->release(_device);
 
     _textures.clear(*this);
 
-    for (uint32_t i = 0; i < MaxFramesInFlight; ++i) {
-        vkDestroyFence(_device, _frameFences[i], nullptr);
+    for (uint32_t i = 0; i < _presentSemaphores.size(); ++i) {
         vkDestroySemaphore(_device, _presentSemaphores[i], nullptr);
     }
+    vkDestroySemaphore(_device, _frameTimeline, nullptr);
+    _gpuProfiler->release(_device);
 
     for (uint32_t i = 0; i < _renderSemaphores.size(); ++i) {
         vkDestroySemaphore(_device, _renderSemaphores[i], nullptr);
     }
 
-    vkDestroyCommandPool(_device, _commandPool, nullptr);
+    for (VkCommandPool commandPool : _commandPools) {
+        vkDestroyCommandPool(_device, commandPool, nullptr);
+    }
+    vkDestroyCommandPool(_device, _recordedPassPool, nullptr);
 
     vmaDestroyAllocator(_allocator);
 
-    vkDestroySwapchainKHR(_device, _swapchain, nullptr);
+    if (!_headless) {
+        vkDestroySwapchainKHR(_device, _swapchain, nullptr);
+    }
     vkDestroyDevice(_device, nullptr);
-    vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    if (!_headless) {
+        vkDestroySurfaceKHR(_instance, _surface, nullptr);
+    }
 
 #if PROJECT_DEBUG
     PFN_vkDestroyDebugUtilsMessengerEXT destroyDebugMessenger = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(_instance, "vkDestroyDebugUtilsMessengerEXT"));
@@ -129,72 +471,667 @@ VulkanRHI::~VulkanRHI()
     TBD_LOG("Vulkan objects cleanup completed");
 }
 
-void VulkanRHI::render(const RenderingDAG& rdag) const
+const PipelineCacheStats& VulkanRHI::getPipelineCacheStats() const
+{
+    return _pipelineCache->getStats();
+}
+
+const DescriptorSetPoolStats& VulkanRHI::getDescriptorSetPoolStats() const
+{
+    return _descriptorSetPoolCompute->getStats();
+}
+
+void VulkanRHI::createSwapchain()
+{
+    VkSwapchainKHR oldSwapchain = _swapchain;
+    _requestedExtent = getOutputExtent();
+
+    auto [swapchain, surfaceFormat, extent] = VKUtils::createSwapchain(_device, _gpu, _surface, _queues, _requestedExtent, _presentMode, oldSwapchain, _directOutput);
+    _swapchain = swapchain;
+    _swapchainExtent = extent;
+    _swapchainFirstFrameId = _frameId;
+
+    if (oldSwapchain != nullptr) {
+        // Without VK_EXT_swapchain_maintenance1 there is no signal for the end of the presentation,
+        // the old images are retired once the frames in flight after the last one using them completed
+        RetiredResources& retired = _retiredResources.emplace_back(RetiredResources { .timelineValue = _frameId - 1 + _framesInFlight, .swapchain = oldSwapchain });
+        retired.semaphores = std::move(_renderSemaphores);
+        for (VulkanTexture* texture : _swapchainTextures) {
+            retired.textures.emplace_back(std::move(*texture));
+        }
+    }
+
+    uint32_t swapchainImageCount;
+    vkGetSwapchainImagesKHR(_device, _swapchain, &swapchainImageCount, nullptr);
+
+    std::vector<VkImage> swapchainImages;
+    swapchainImages.resize(swapchainImageCount);
+    vkGetSwapchainImagesKHR(_device, _swapchain, &swapchainImageCount, swapchainImages.data());
+
+    // Texture slots are reused between swapchains, the allocator doesn't support releasing yet
+    for (uint32_t i = 0; i < swapchainImageCount; ++i) {
+        VulkanTexture texture { this, swapchainImages[i], surfaceFormat, VkExtent3D { _swapchainExtent.width, _swapchainExtent.height, 1 }, VK_IMAGE_ASPECT_COLOR_BIT };
+        if (i < _swapchainTextures.size()) {
+            *_swapchainTextures[i] = std::move(texture);
+        } else {
+            _swapchainTextures.emplace_back(&_textures.getResource(_textures.allocate(this, std::move(texture))));
+        }
+    }
+    _swapchainTextures.resize(swapchainImageCount);
+
+    _renderSemaphores.resize(swapchainImageCount);
+    for (uint32_t i = 0; i < _renderSemaphores.size(); ++i) {
+        _renderSemaphores[i] = VKUtils::createSemaphore(_device);
+    }
+}
+
+void VulkanRHI::createOffscreenImages()
+{
+    _requestedExtent = _headlessExtent;
+    _swapchainExtent = _headlessExtent;
+
+    for (uint32_t i = 0; i < _framesInFlight; ++i) {
+        VulkanTexture image {
+            this,
+            OffscreenImageFormat,
+            VkExtent3D { _swapchainExtent.width, _swapchainExtent.height, 1 },
+            OffscreenImageUsage,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            MemoryCategory::RenderTarget,
+            false
+        };
+        _swapchainTextures.emplace_back(&_textures.getResource(_textures.allocate(this, std::move(image))));
+    }
+
+    if (_captureDirectory.empty()) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(_captureDirectory, error);
+    if (error) {
+        TBD_WARN("Failed to create the capture directory " << _captureDirectory << ", frames won't be captured");
+        _captureDirectory.clear();
+        return;
+    }
+
+    for (uint32_t i = 0; i < _framesInFlight; ++i) {
+        _captureBuffers.emplace_back(this, 4 * _swapchainExtent.width * _swapchainExtent.height, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU, MemoryCategory::Staging);
+    }
+    _captureFrameIds.resize(_framesInFlight, 0);
+
+    TBD_LOG("Capturing frames to " << _captureDirectory);
+}
+
+VkExtent2D VulkanRHI::getOutputExtent() const
+{
+    return _window != nullptr ? VkExtent2D { _window->getWidth(), _window->getHeight() } : _headlessExtent;
+}
+
+void VulkanRHI::writeCapture(uint32_t frameInFlightId)
+{
+    if (_captureFrameIds.empty() || _captureFrameIds[frameInFlightId] == 0) {
+        return;
+    }
+
+    TBD_PROFILE_FUNCTION();
+
+    const VulkanBuffer& buffer = _captureBuffers[frameInFlightId];
+    vmaInvalidateAllocation(_allocator, buffer.getAllocation(), 0, VK_WHOLE_SIZE);
+
+    std::ostringstream name;
+    name << "frame_" << std::setw(6) << std::setfill('0') << _captureFrameIds[frameInFlightId] << ".ppm";
+    _captureFrameIds[frameInFlightId] = 0;
+
+    std::ofstream file { _captureDirectory / name.str(), std::ios::binary };
+    if (!file.is_open()) {
+        TBD_WARN("Failed to open " << _captureDirectory / name.str());
+        return;
+    }
+
+    // Binary PPM, the alpha channel is dropped
+    const uint32_t pixelCount = _swapchainExtent.width * _swapchainExtent.height;
+    const auto* rgba = static_cast<const char*>(buffer.getMappedData());
+    std::vector<char> rgb(3 * size_t(pixelCount));
+    for (uint32_t i = 0; i < pixelCount; ++i) {
+        std::copy_n(rgba + 4 * size_t(i), 3, rgb.data() + 3 * size_t(i));
+    }
+
+    file << "P6\n"
+         << _swapchainExtent.width << " " << _swapchainExtent.height << "\n255\n";
+    file.write(rgb.data(), rgb.size());
+}
+
+void VulkanRHI::createRenderTargets()
+{
+    if (_directOutput) {
+        _renderTargetExtent = _swapchainExtent;
+        return;
+    }
+
+    if (!_renderTargets.empty()) {
+        // Every frame in flight may still be rendering to its target
+        RetiredResources& retired = _retiredResources.emplace_back(RetiredResources { .timelineValue = _frameId - 1 });
+        for (VulkanTexture* renderTarget : _renderTargets) {
+            retired.textures.emplace_back(std::move(*renderTarget));
+        }
+    }
+
+    const float maxScale = _dynamicResolution.getMaxScale();
+    _renderTargetExtent = {
+        std::max(1u, static_cast<uint32_t>(std::ceil(_swapchainExtent.width * maxScale))),
+        std::max(1u, static_cast<uint32_t>(std::ceil(_swapchainExtent.height * maxScale)))
+    };
+
+    for (uint32_t i = 0; i < _framesInFlight; ++i) {
+        VulkanTexture renderTarget {
+            this,
+            RenderTargetFormat,
+            VkExtent3D { _renderTargetExtent.width, _renderTargetExtent.height, 1 },
+            RenderTargetUsage,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            MemoryCategory::RenderTarget
+        };
+
+        if (i < _renderTargets.size()) {
+            *_renderTargets[i] = std::move(renderTarget);
+        } else {
+            _renderTargets.emplace_back(&_textures.getResource(_textures.allocate(this, std::move(renderTarget))));
+        }
+    }
+}
+
+bool VulkanRHI::readGpuFrameTime(uint32_t frameInFlightId)
+{
+    // The frame already completed on the timeline, no need to wait for the results
+    if (!_gpuProfiler->readback(_device, frameInFlightId)) {
+        return false;
+    }
+
+    _gpuFrameMs = _gpuProfiler->getLastMs(FramePass);
+    _gpuFrameMsSum += _gpuFrameMs;
+    ++_gpuFrameCount;
+    return true;
+}
+
+void VulkanRHI::recreateSwapchain()
+{
+    TBD_PROFILE_FUNCTION();
+
+    const auto start = std::chrono::steady_clock::now();
+
+    createSwapchain();
+    createRenderTargets();
+    _swapchainDirty = false;
+
+    // Handles of the replaced images may be reused by the new ones, the inputs comparison can't be trusted
+    for (RecordedFramePasses& passes : _recordedPasses) {
+        for (RecordedGradientPass& gradient : passes.gradients) {
+            gradient.pass.invalidate();
+        }
+        for (VulkanRecordedPass& blit : passes.blits) {
+            blit.invalidate();
+        }
+    }
+
+    const float recreationMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    _swapchainStats.lastRecreationMs = recreationMs;
+    _swapchainStats.maxRecreationMs = std::max(_swapchainStats.maxRecreationMs, recreationMs);
+    ++_swapchainStats.recreationCount;
+
+    TBD_DEBUG("Swapchain recreated at " << _swapchainExtent.width << "x" << _swapchainExtent.height << " in " << recreationMs << "ms");
+}
+
+void VulkanRHI::releaseRetiredResources(bool force)
+{
+    if (_retiredResources.empty()) {
+        return;
+    }
+
+    uint64_t completedFrameId = TBD_MAX_T(uint64_t);
+    if (!force) {
+        vkGetSemaphoreCounterValue(_device, _frameTimeline, &completedFrameId);
+    }
+
+    auto isCompleted = [completedFrameId](const RetiredResources& retired) { return retired.timelineValue <= completedFrameId; };
+    for (RetiredResources& retired : _retiredResources) {
+        if (!isCompleted(retired)) {
+            continue;
+        }
+
+        for (VulkanTexture& texture : retired.textures) {
+            texture.release(*this);
+        }
+        for (VkSemaphore semaphore : retired.semaphores) {
+            vkDestroySemaphore(_device, semaphore, nullptr);
+        }
+        if (retired.swapchain != nullptr) {
+            vkDestroySwapchainKHR(_device, retired.swapchain, nullptr);
+        }
+    }
+
+    std::erase_if(_retiredResources, isCompleted);
+}
+
+void VulkanRHI::render(const RenderingDAG& rdag)
 {
     // rdag.render<VulkanRHI>(this);
 
-    const uint32_t frameInFlightId = _frameId % MaxFramesInFlight;
+    // Engine::run waits for the window to be restored, the frame is only skipped for other callers
+    if (_window != nullptr && _window->isMinimized()) {
+        return;
+    }
+
+    TBD_PROFILE_FUNCTION();
+
+    const auto frameStart = std::chrono::steady_clock::now();
+    const uint32_t frameInFlightId = _frameId % _framesInFlight;
+    _frameTimings = FrameTimings { .frameId = _frameId };
+
+    releaseRetiredResources();
 
-    if (vkWaitForFences(_device, 1, &_frameFences[frameInFlightId], VK_TRUE, TBD_MAX_T(uint64_t)) != VK_SUCCESS) {
-        TBD_ABORT_VK("GPU stall detected");
+    const VkExtent2D outputExtent = getOutputExtent();
+    const bool resized = _requestedExtent.width != outputExtent.width || _requestedExtent.height != outputExtent.height;
+    if (resized || _swapchainDirty) {
+        recreateSwapchain();
     }
-    vkResetFences(_device, 1, &_frameFences[frameInFlightId]);
 
-    uint32_t swapchainImageId;
-    if (vkAcquireNextImageKHR(_device, _swapchain, TBD_MAX_T(uint64_t), _presentSemaphores[frameInFlightId], nullptr, &swapchainImageId) != VK_SUCCESS) {
-        TBD_ABORT_VK("Failed to acquire next swapchain image");
+    if (_lowLatency) {
+        _frameStartTimes[frameInFlightId] = std::chrono::steady_clock::now();
     }
 
-    VkCommandBuffer commandBuffer = getCommandBuffer();
+    // Wait for the frame that last used this frame in flight resources
+    {
+        TBD_PROFILE_ZONE("Timeline wait");
+        const auto waitStart = std::chrono::steady_clock::now();
+        if (_frameId > _framesInFlight && VKUtils::waitTimelineSemaphore(_device, _frameTimeline, _frameId - _framesInFlight) != VK_SUCCESS) {
+            TBD_ABORT_VK("GPU stall detected");
+        }
+        _frameTimings.fenceWaitMs = getElapsedMs(waitStart);
+    }
 
-    VKUtils::beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    // Headless frames own their offscreen image for as long as they are in flight
+    uint32_t swapchainImageId = frameInFlightId;
+    if (!_headless) {
+        VkResult acquireResult;
+        {
+            TBD_PROFILE_ZONE("Acquire");
+            const auto acquireStart = std::chrono::steady_clock::now();
+            acquireResult = vkAcquireNextImageKHR(_device, _swapchain, TBD_MAX_T(uint64_t), _presentSemaphores[frameInFlightId], nullptr, &swapchainImageId);
+            _frameTimings.acquireWaitMs = getElapsedMs(acquireStart);
+        }
+        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            // Nothing was acquired, the semaphore stays unsignaled and the frame is retried with a new swapchain
+            _swapchainDirty = true;
+            return;
+        } else if (acquireResult == VK_SUBOPTIMAL_KHR) {
+            _swapchainDirty = true;
+        } else if (acquireResult != VK_SUCCESS) {
+            TBD_ABORT_VK("Failed to acquire next swapchain image");
+        }
+    }
 
-    VulkanTexture* renderTarget = _renderTargets[frameInFlightId];
-    renderTarget->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_GENERAL);
+    // Only once the frame is sure to be submitted, a retried frame would lose the profiler results of the slot
+    writeCapture(frameInFlightId);
+    _memoryTracker->update(_frameId);
 
-    VkDescriptorSet descriptorSet = _descriptorSetPoolCompute->getDescriptorSet(_device, frameInFlightId);
+    if (readGpuFrameTime(frameInFlightId)) {
+        _dynamicResolution.update(_gpuFrameMs, _frameScales[frameInFlightId]);
+        _frameTimings.gpuMs = _gpuFrameMs;
+    }
 
-    // update DS, bind pipeline, bind DS, dispatch
-    VkDescriptorImageInfo imageInfo {
-        .imageView = renderTarget->getView(),
-        .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+    const float scale = _dynamicResolution.getScale();
+    _frameScales[frameInFlightId] = scale;
+    const VkExtent2D renderExtent {
+        std::clamp(static_cast<uint32_t>(_swapchainExtent.width * scale), 1u, _renderTargetExtent.width),
+        std::clamp(static_cast<uint32_t>(_swapchainExtent.height * scale), 1u, _renderTargetExtent.height)
     };
-    _descriptorSetPoolCompute->updateDescriptorSet(_device, commandBuffer, descriptorSet, _computePipeline->getLayout(), imageInfo);
-    _descriptorSetPoolCompute->bind(commandBuffer, descriptorSet, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline->getLayout());
-    _computePipeline->dispatch(commandBuffer, { std::ceil(renderTarget->getWidth() / 8.f), std::ceil(renderTarget->getHeight() / 8.f), 1 });
 
-    renderTarget->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    // The frame that last used the pool completed on the timeline
+    vkResetCommandPool(_device, _commandPools[frameInFlightId], 0);
+
+    VkCommandBuffer commandBuffer = getCommandBuffer();
+
+    VKUtils::beginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, false);
+
+    _gpuProfiler->beginFrame(commandBuffer, frameInFlightId);
+    _gpuProfiler->beginPass(commandBuffer, FramePass);
+
+    VulkanTexture* renderTarget = _directOutput ? _swapchainTextures[swapchainImageId] : _renderTargets[frameInFlightId];
+
+    // Barriers stay in the primary command buffer, they depend on the tracked layouts
+    recordWorkloadFrame(
+        _workload,
+        _directOutput,
+        [&]() { streamTexture(commandBuffer, frameInFlightId); },
+        [&]() {
+            renderTarget->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_GENERAL);
+
+            RecordedGradientPass& gradient = getGradientPass(frameInFlightId, swapchainImageId);
+            VulkanGpuProfiler::Scope scope { *_gpuProfiler, commandBuffer, "Gradient", _gradientStatistics };
+            gradient.pass.execute(commandBuffer, GradientPassInputs { renderTarget->getView(), _computePipeline, renderExtent }, [&](VkCommandBuffer recordBuffer) {
+                // update DS, bind pipeline, bind DS, dispatch
+                VkDescriptorImageInfo imageInfo {
+                    .imageView = renderTarget->getView(),
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+                };
+                _descriptorSetPoolCompute->updateDescriptorSet(_device, recordBuffer, gradient.descriptorSet, _computePipeline->getLayout(), imageInfo);
+                _descriptorSetPoolCompute->bind(recordBuffer, gradient.descriptorSet, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline->getLayout());
+                _computePipeline->pushConstants(recordBuffer, GradientConstants { .resolution = { renderExtent.width, renderExtent.height } });
+                recordWorkloadDispatches(
+                    _workload,
+                    [&]() { insertComputeBarrier(recordBuffer); },
+                    [&]() { _computePipeline->dispatch(recordBuffer, { renderExtent.width, renderExtent.height, 1 }); });
+            });
+        },
+        [&]() {
+            renderTarget->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+            VulkanGpuProfiler::Scope scope { *_gpuProfiler, commandBuffer, "Triangle", true };
+            // TODO: watch for the tiny vector allocations
+            _graphicsPipeline->beginRendering(commandBuffer,
+                renderExtent,
+                { renderTarget->getAttachmentInfo() });
+
+            recordWorkloadDraws(_workload, [&](uint32_t i) {
+                _graphicsPipeline->pushConstants(commandBuffer, TriangleConstants { .transform = getGridTransform(i, _workload.drawCount) });
+                vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+            });
+
+            _graphicsPipeline->endRendering(commandBuffer);
+        },
+        [&]() {
+            renderTarget->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+            VulkanTexture* target = _swapchainTextures[swapchainImageId];
+            target->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
-    // TODO: watch for the tiny vector allocations
-    _graphicsPipeline->draw(commandBuffer,
-        { renderTarget->getWidth(), renderTarget->getHeight() },
-        { renderTarget->getAttachmentInfo() });
+            VulkanGpuProfiler::Scope scope { *_gpuProfiler, commandBuffer, "Blit" };
+            getBlitPass(frameInFlightId, swapchainImageId).execute(commandBuffer, BlitPassInputs { renderTarget->getVkImage(), target->getVkImage(), renderExtent, _swapchainExtent }, [&](VkCommandBuffer recordBuffer) {
+                renderTarget->blit(recordBuffer, *target, renderExtent, VK_FILTER_LINEAR);
+            });
+        });
 
-    renderTarget->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+#if TBD_HUD
+    if (_hud) {
+        TBD_PROFILE_ZONE("HUD");
 
-    _swapchainTextures[swapchainImageId]->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    renderTarget->blit(commandBuffer, *_swapchainTextures[swapchainImageId]);
+        VulkanTexture* target = _swapchainTextures[swapchainImageId];
+        target->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+        _hud->update(*this);
+
+        VulkanGpuProfiler::Scope scope { *_gpuProfiler, commandBuffer, "HUD" };
+        _hud->render(commandBuffer, *target, _swapchainExtent);
+    }
+#endif
+
+    if (!_headless) {
+        _swapchainTextures[swapchainImageId]->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    } else if (!_captureBuffers.empty()) {
+        VulkanTexture* image = _swapchainTextures[swapchainImageId];
+        image->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        VkBufferImageCopy region {
+            .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1 },
+            .imageExtent = { _swapchainExtent.width, _swapchainExtent.height, 1 }
+        };
+        {
+            VulkanGpuProfiler::Scope scope { *_gpuProfiler, commandBuffer, "Capture" };
+            vkCmdCopyImageToBuffer(commandBuffer, image->getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _captureBuffers[frameInFlightId].getVkBuffer(), 1, &region);
+        }
+
+        // The timeline signal alone doesn't make the copy visible to the host
+        VkMemoryBarrier2 hostBarrier {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+            .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+            .dstAccessMask = VK_ACCESS_2_HOST_READ_BIT
+        };
+        VkDependencyInfo dependencyInfo {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &hostBarrier
+        };
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+        _captureFrameIds[frameInFlightId] = _frameId;
+    }
 
-    _swapchainTextures[swapchainImageId]->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    _gpuProfiler->endPass(commandBuffer);
 
     vkEndCommandBuffer(commandBuffer);
-    VKUtils::submitCommandBuffer(_graphicsQueue,
-        VKUtils::makeSemaphoreSubmitInfo(_presentSemaphores[frameInFlightId], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR),
+
+    if (_headless) {
+        TBD_PROFILE_ZONE("Submit");
+        const auto submitStart = std::chrono::steady_clock::now();
+        const VkSemaphoreSubmitInfo signalSemaphores[] = {
+            VKUtils::makeSemaphoreSubmitInfo(_frameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _frameId)
+        };
+        VKUtils::submitCommandBuffer(_graphicsQueue, std::span<const VkSemaphoreSubmitInfo> {}, signalSemaphores, commandBuffer);
+        _frameTimings.submitMs = getElapsedMs(submitStart);
+    } else {
+        present(commandBuffer, frameInFlightId, swapchainImageId);
+    }
+
+    if (_lowLatency) {
+        const auto waitStart = std::chrono::steady_clock::now();
+        waitForOldestPresent();
+        _frameTimings.presentWaitMs = getElapsedMs(waitStart);
+    }
+
+    _frameTimings.frameMs = getElapsedMs(frameStart);
+    _framePacing.record(_frameTimings, !_headless);
+
+    if (!_frameCapturePath.empty()) {
+        if (_frameCaptureId == _frameId) {
+            _frameCapture = describeFrame(scale);
+            writeFrameCapture();
+        } else if (_frameCaptureId == 0 && _frameId > FrameCaptureWarmup && _frameTimings.frameMs > _frameCapture.cpuFrameMs) {
+            _frameCapture = describeFrame(scale);
+        }
+    }
+
+    if (resized) {
+        _swapchainStats.maxResizeFrameMs = std::max(_swapchainStats.maxResizeFrameMs, _frameTimings.frameMs);
+    }
+
+    ++_frameId;
+}
+
+void VulkanRHI::present(VkCommandBuffer commandBuffer, uint32_t frameInFlightId, uint32_t swapchainImageId)
+{
+    TBD_PROFILE_FUNCTION();
+
+    const auto submitStart = std::chrono::steady_clock::now();
+    const VkSemaphoreSubmitInfo waitSemaphores[] = {
+        VKUtils::makeSemaphoreSubmitInfo(_presentSemaphores[frameInFlightId], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR)
+    };
+    const VkSemaphoreSubmitInfo signalSemaphores[] = {
         VKUtils::makeSemaphoreSubmitInfo(_renderSemaphores[swapchainImageId], VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT),
-        commandBuffer,
-        _frameFences[frameInFlightId]);
+        VKUtils::makeSemaphoreSubmitInfo(_frameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, _frameId)
+    };
+    VKUtils::submitCommandBuffer(_graphicsQueue, waitSemaphores, signalSemaphores, commandBuffer);
+    _frameTimings.submitMs = getElapsedMs(submitStart);
+
+    const uint64_t presentId = _frameId;
+    VkPresentIdKHR presentIdInfo {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &presentId
+    };
 
     VkPresentInfoKHR presentInfo {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = _waitForPresent != nullptr ? &presentIdInfo : nullptr,
         .waitSemaphoreCount = 1,
         .pWaitSemaphores = &_renderSemaphores[swapchainImageId],
         .swapchainCount = 1,
         .pSwapchains = &_swapchain,
         .pImageIndices = &swapchainImageId,
     };
-    vkQueuePresentKHR(_presentQueue, &presentInfo);
+    const auto presentStart = std::chrono::steady_clock::now();
+    const VkResult presentResult = vkQueuePresentKHR(_presentQueue, &presentInfo);
+    _frameTimings.presentMs = getElapsedMs(presentStart);
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR) {
+        _swapchainDirty = true;
+    } else if (presentResult != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to present swapchain image");
+    }
+}
 
-    ++_frameId;
+VulkanRHI::RecordedGradientPass& VulkanRHI::getGradientPass(uint32_t frameInFlightId, uint32_t swapchainImageId)
+{
+    std::vector<RecordedGradientPass>& gradients = _recordedPasses[frameInFlightId].gradients;
+    const uint32_t passId = _directOutput ? swapchainImageId : 0;
+    while (gradients.size() <= passId) {
+        VkCommandBuffer commandBuffer;
+        VKUtils::allocateCommandBuffers(_device, _recordedPassPool, 1, &commandBuffer, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+        // Only the gradient pass is replayed inside a pipeline statistics query
+        const VkQueryPipelineStatisticFlags inheritedStatistics = _gradientStatistics ? _gpuProfiler->getPipelineStatisticFlags() : 0;
+        gradients.emplace_back(RecordedGradientPass {
+            .pass { commandBuffer, &_recordedPassStats, inheritedStatistics },
+            .descriptorSet = _descriptorSetPoolCompute->allocatePersistentDescriptorSet(_device) });
+    }
+
+    return gradients[passId];
+}
+
+VulkanRecordedPass& VulkanRHI::getBlitPass(uint32_t frameInFlightId, uint32_t swapchainImageId)
+{
+    std::vector<VulkanRecordedPass>& blits = _recordedPasses[frameInFlightId].blits;
+    while (blits.size() <= swapchainImageId) {
+        VkCommandBuffer commandBuffer;
+        VKUtils::allocateCommandBuffers(_device, _recordedPassPool, 1, &commandBuffer, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        blits.emplace_back(commandBuffer, &_recordedPassStats);
+    }
+
+    return blits[swapchainImageId];
+}
+
+bool VulkanRHI::setStreamedTextureData(std::span<const uint8_t> data)
+{
+    if (data.size() != _streamingSource.size() * sizeof(uint32_t)) {
+        TBD_WARN("Streamed texture data of " << data.size() << " bytes doesn't match the " << _workload.streamedTextureSize << " texture streaming workload");
+        return false;
+    }
+
+    std::memcpy(_streamingSource.data(), data.data(), data.size());
+    return true;
+}
+
+FrameCapture VulkanRHI::describeFrame(float resolutionScale) const
+{
+    FrameCapture capture {
+        .deviceName = _deviceName,
+        .frameId = _frameId,
+        .cpuFrameMs = _frameTimings.frameMs,
+        .gpuFrameMs = _gpuFrameMs,
+        .width = _swapchainExtent.width,
+        .height = _swapchainExtent.height,
+        .framesInFlight = _framesInFlight,
+        .resolutionScale = resolutionScale,
+        .directOutput = _directOutput,
+        .workload = _workload
+    };
+
+    auto addTexture = [&capture](const VulkanTexture& texture, VkImageUsageFlags usage, MemoryCategory category) {
+        capture.resources.emplace_back(CapturedResource {
+            .type = CapturedResource::Type::Texture,
+            .category = static_cast<uint8_t>(category),
+            .format = static_cast<uint32_t>(texture.getFormat()),
+            .usage = usage,
+            .width = texture.getWidth(),
+            .height = texture.getHeight() });
+    };
+
+    for (const VulkanTexture* renderTarget : _renderTargets) {
+        addTexture(*renderTarget, RenderTargetUsage, MemoryCategory::RenderTarget);
+    }
+    if (_headless) {
+        for (const VulkanTexture* image : _swapchainTextures) {
+            addTexture(*image, OffscreenImageUsage, MemoryCategory::RenderTarget);
+        }
+    }
+    if (_streamedTexture != nullptr) {
+        addTexture(*_streamedTexture, StreamedTextureUsage, MemoryCategory::StreamedTexture);
+        for (const VulkanBuffer& buffer : _streamingBuffers) {
+            capture.resources.emplace_back(CapturedResource {
+                .type = CapturedResource::Type::Buffer,
+                .category = static_cast<uint8_t>(MemoryCategory::Staging),
+                .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                .width = static_cast<uint32_t>(buffer.getSize()) });
+        }
+    }
+
+    return capture;
+}
+
+void VulkanRHI::writeFrameCapture()
+{
+    // The streamed data is the same every frame, only added once the frame is known
+    if (_streamedTexture != nullptr) {
+        const auto streamedTexture = std::find_if(_frameCapture.resources.begin(), _frameCapture.resources.end(), [](const CapturedResource& resource) {
+            return resource.category == static_cast<uint8_t>(MemoryCategory::StreamedTexture);
+        });
+        const auto* bytes = reinterpret_cast<const uint8_t*>(_streamingSource.data());
+        _frameCapture.uploads.emplace_back(CapturedUpload {
+            .resourceId = static_cast<uint32_t>(streamedTexture - _frameCapture.resources.begin()),
+            .data { bytes, bytes + _streamingSource.size() * sizeof(uint32_t) } });
+    }
+
+    _frameCapture.save(_frameCapturePath);
+}
+
+void VulkanRHI::streamTexture(VkCommandBuffer commandBuffer, uint32_t frameInFlightId)
+{
+    TBD_PROFILE_FUNCTION();
+
+    // The frame that last used the staging buffer completed on the timeline, the submission makes the host writes visible
+    const VulkanBuffer& staging = _streamingBuffers[frameInFlightId];
+    std::memcpy(staging.getMappedData(), _streamingSource.data(), _streamingSource.size() * sizeof(uint32_t));
+    vmaFlushAllocation(_allocator, staging.getAllocation(), 0, VK_WHOLE_SIZE);
+
+    _streamedTexture->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    VkBufferImageCopy region {
+        .imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1 },
+        .imageExtent = { _streamedTexture->getWidth(), _streamedTexture->getHeight(), 1 }
+    };
+    {
+        VulkanGpuProfiler::Scope scope { *_gpuProfiler, commandBuffer, "Streaming" };
+        vkCmdCopyBufferToImage(commandBuffer, staging.getVkBuffer(), _streamedTexture->getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    _streamedTexture->insertBarrier(commandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+void VulkanRHI::waitForOldestPresent()
+{
+    // Oldest frame still in flight once the next one starts, the current one with a single frame in flight
+    if (_frameId + 1 <= _framesInFlight) {
+        return;
+    }
+
+    TBD_PROFILE_FUNCTION();
+    const uint32_t oldestFrameId = _frameId + 1 - _framesInFlight;
+
+    // Frames presented to a retired swapchain can't be waited for on the current one, their submission is waited instead
+    const VkResult result = _waitForPresent != nullptr && oldestFrameId >= _swapchainFirstFrameId
+        ? _waitForPresent(_device, _swapchain, oldestFrameId, TBD_MAX_T(uint64_t))
+        : VKUtils::waitTimelineSemaphore(_device, _frameTimeline, oldestFrameId);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        _swapchainDirty = true;
+    } else if (result != VK_SUCCESS) {
+        TBD_ABORT_VK("Failed to wait for frame " << oldestFrameId);
+    }
+
+    const float latencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - _frameStartTimes[oldestFrameId % _framesInFlight]).count();
+    _latencyStats.maxMs = std::max(_latencyStats.maxMs, latencyMs);
+    _latencyStats.averageMs += (latencyMs - _latencyStats.averageMs) / float(++_latencyStats.sampleCount);
 }
 
 } // namespace TBD
\ No newline at end of file
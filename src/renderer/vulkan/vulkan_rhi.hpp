@@ -1,12 +1,24 @@
 #pragma once
 
-#include <array>
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <misc/utils.hpp>
+#include <renderer/core/dynamic_resolution.hpp>
+#include <renderer/core/frame_capture.hpp>
+#include <renderer/core/frame_pacing.hpp>
 #include <renderer/core/resource_allocator.hpp>
 #include <renderer/core/rhi_interface.hpp>
 #include <renderer/rendering_dag/rendering_dag.hpp>
+#include <renderer/vulkan/vulkan_buffer.hpp>
+#include <renderer/vulkan/vulkan_gpu_profiler.hpp>
+#include <renderer/vulkan/vulkan_memory_tracker.hpp>
+#include <renderer/vulkan/vulkan_recorded_pass.hpp>
 #include <renderer/vulkan/vulkan_texture.hpp>
+#include <renderer/vulkan/vulkan_utils.hpp>
+#include <span>
+#include <string>
+#include <vector>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_core.h>
@@ -14,9 +26,34 @@
 namespace TBD {
 
 class Window;
-template <uint32_t>
+class StartupTrace;
+struct RendererConfig;
 class VulkanDescriptorSetPool;
 class VulkanPipeline;
+class VulkanPipelineCache;
+struct PipelineCacheStats;
+struct DescriptorSetPoolStats;
+class VulkanHud;
+
+// Only measured in low latency mode, where the CPU waits for each present
+struct FrameLatencyStats {
+    // From the start of a frame, right after the input was polled, to its presentation
+    float averageMs = 0.f;
+    float maxMs = 0.f;
+    uint32_t sampleCount = 0;
+
+    // False when present wait is unavailable, the GPU completion is then used as an estimate
+    bool measuredAtPresent = false;
+};
+
+struct SwapchainStats {
+    uint32_t recreationCount = 0;
+
+    // CPU time of the recreations, and of the whole frames they happened in
+    float lastRecreationMs = 0.f;
+    float maxRecreationMs = 0.f;
+    float maxResizeFrameMs = 0.f;
+};
 
 class VulkanRHI : public IRHI {
     TBD_NO_COPY_MOVE(VulkanRHI)
@@ -28,19 +65,101 @@ public:
 public:
     VulkanRHI() = delete;
 
-    VulkanRHI(const Window& _window);
+    // Headless without a window, see RendererConfig::headless
+    VulkanRHI(const Window* window, const RendererConfig& config, StartupTrace* trace = nullptr);
 
     ~VulkanRHI();
 
     inline VkDevice getVkDevice() const { return _device; }
 
+    [[nodiscard]] inline const std::string& getDeviceName() const { return _deviceName; }
+
     inline VmaAllocator getAllocator() const { return _allocator; }
 
-    inline VkCommandBuffer getCommandBuffer() const { return _commandBuffers[_frameId % MaxFramesInFlight]; }
+    // Every texture and buffer allocation is tracked there by category
+    [[nodiscard]] inline VulkanMemoryTracker& getMemoryTracker() const { return *_memoryTracker; }
+
+    inline VkCommandBuffer getCommandBuffer() const { return _commandBuffers[_frameId % _framesInFlight]; }
+
+    inline uint32_t getFramesInFlight() const { return _framesInFlight; }
 
     inline VulkanTexture& getTexture(RID rid) { return _textures.getResource(rid); }
 
-    virtual void render(const RenderingDAG& rdag) const override;
+    [[nodiscard]] const PipelineCacheStats& getPipelineCacheStats() const;
+
+    [[nodiscard]] const DescriptorSetPoolStats& getDescriptorSetPoolStats() const;
+
+    [[nodiscard]] inline const RecordedPassStats& getRecordedPassStats() const { return _recordedPassStats; }
+
+    [[nodiscard]] inline const FrameLatencyStats& getLatencyStats() const { return _latencyStats; }
+
+    [[nodiscard]] inline const SwapchainStats& getSwapchainStats() const { return _swapchainStats; }
+
+    // GPU time of the last completed frame, 0 until the first one completed
+    [[nodiscard]] inline float getGpuFrameMs() const { return _gpuFrameMs; }
+
+    [[nodiscard]] inline float getResolutionScale() const { return _dynamicResolution.getScale(); }
+
+    // Sum of the GPU time of the completed frames
+    [[nodiscard]] inline double getTotalGpuFrameMs() const { return _gpuFrameMsSum; }
+
+    // Where the CPU time of the recent frames went and what bound them
+    [[nodiscard]] inline const FramePacing& getFramePacing() const { return _framePacing; }
+
+    // Rolling GPU time of the frame and of each pass
+    [[nodiscard]] inline std::vector<GpuPassStats> getGpuPassStats() const { return _gpuProfiler->getStats(); }
+
+    // Replaces the data uploaded every frame by the texture streaming workload, returns false when the size doesn't match
+    bool setStreamedTextureData(std::span<const uint8_t> data);
+
+    // The last frame wasn't presented or left the swapchain out of date
+    [[nodiscard]] inline bool needsRedraw() const { return _swapchainDirty; }
+
+    virtual void render(const RenderingDAG& rdag) override;
+
+private:
+    // Retires the current swapchain if any and creates one matching the window through oldSwapchain
+    void createSwapchain();
+
+    // Headless stand-in for the swapchain, one image per frame in flight
+    void createOffscreenImages();
+
+    [[nodiscard]] VkExtent2D getOutputExtent() const;
+
+    // Writes the readback of the frame that last used frameInFlightId to the capture directory
+    void writeCapture(uint32_t frameInFlightId);
+
+    // Allocated at the max dynamic resolution scale, frames render to a sub rectangle, none with direct output
+    void createRenderTargets();
+
+    // Reads the pass timestamps of the frame that last used frameInFlightId, returns false if it never ran
+    [[nodiscard]] bool readGpuFrameTime(uint32_t frameInFlightId);
+
+    // Replaces the swapchain and the size dependent resources without waiting for the device
+    void recreateSwapchain();
+
+    // Destroys the retired resources the GPU is done with, all of them when force is set
+    void releaseRetiredResources(bool force = false);
+
+    // Submits the frame waiting for the acquired image and presents it
+    void present(VkCommandBuffer commandBuffer, uint32_t frameInFlightId, uint32_t swapchainImageId);
+
+    // Created on first use, the passes of a frame in flight are only recorded again once that frame completed
+    struct RecordedGradientPass;
+    [[nodiscard]] RecordedGradientPass& getGradientPass(uint32_t frameInFlightId, uint32_t swapchainImageId);
+
+    [[nodiscard]] VulkanRecordedPass& getBlitPass(uint32_t frameInFlightId, uint32_t swapchainImageId);
+
+    // Configuration and resources of the current frame, the uploads are only added by writeFrameCapture
+    [[nodiscard]] FrameCapture describeFrame(float resolutionScale) const;
+
+    void writeFrameCapture();
+
+    // Texture streaming workload, uploads the CPU source through the staging buffer of the frame in flight
+    void streamTexture(VkCommandBuffer commandBuffer, uint32_t frameInFlightId);
+
+    // Low latency mode, called after the present so the input is polled once the wait is over
+    void waitForOldestPresent();
 
 private:
     VkInstance _instance;
@@ -48,35 +167,134 @@ private:
     VkDebugUtilsMessengerEXT _debugUtilsMessenger;
 #endif
     VkPhysicalDevice _gpu;
+    std::string _deviceName;
 
-    VkSurfaceKHR _surface;
+    const Window* _window;
+    VkSurfaceKHR _surface = nullptr;
 
     VkDevice _device;
     VmaAllocator _allocator;
+    Uptr<VulkanMemoryTracker> _memoryTracker;
+
+    // Written at shutdown when set, see RendererConfig::memoryStatsPath
+    std::filesystem::path _memoryStatsPath;
 
     VkQueue _graphicsQueue;
     VkQueue _presentQueue;
+    VKUtils::PhysicalDeviceQueueFamilyID _queues;
+
+    VkSwapchainKHR _swapchain = nullptr;
+    VkPresentModeKHR _presentMode;
+    VkExtent2D _swapchainExtent;
 
-    VkSwapchainKHR _swapchain;
+    // Window size the swapchain was last created for, _swapchainExtent is clamped to the surface and can differ
+    VkExtent2D _requestedExtent;
     std::vector<VulkanTexture*> _swapchainTextures;
 
-    VkCommandPool _commandPool;
+    bool _headless;
+    VkExtent2D _headlessExtent;
+
+    // Frames render to the swapchain images, see RendererConfig::directOutput
+    bool _directOutput = false;
+
+    // Headless frame capture, readback buffers of each frame in flight and the frame they hold, 0 when empty
+    std::filesystem::path _captureDirectory;
+    std::vector<VulkanBuffer> _captureBuffers;
+    std::vector<uint32_t> _captureFrameIds;
+
+    // Set when acquire or present report the swapchain out of date or suboptimal
+    bool _swapchainDirty = false;
+    SwapchainStats _swapchainStats;
 
-    static constexpr uint32_t MaxFramesInFlight = 2;
-    std::array<VkCommandBuffer, MaxFramesInFlight> _commandBuffers;
-    std::array<VkFence, MaxFramesInFlight> _frameFences;
-    std::array<VulkanTexture*, MaxFramesInFlight> _renderTargets;
+    // Resources replaced while frames may still use them, destroyed once the frame timeline reaches timelineValue
+    struct RetiredResources {
+        uint64_t timelineValue;
+        VkSwapchainKHR swapchain = nullptr;
+        std::vector<VkSemaphore> semaphores;
+        std::vector<VulkanTexture> textures;
+    };
+    std::vector<RetiredResources> _retiredResources;
 
-    std::array<VkSemaphore, MaxFramesInFlight> _presentSemaphores;
+    // One transient pool per frame in flight, reset in bulk once the frame that last used it completed
+    std::vector<VkCommandPool> _commandPools;
+
+    // Secondary command buffers of the recorded passes, reset individually when recorded again
+    VkCommandPool _recordedPassPool;
+
+    // Static passes recorded once and replayed, indexed by frameInFlightId. The gradient pass writes the render target
+    // of the frame in flight, so it is only indexed by swapchainImageId with direct output, the blit always is
+    struct RecordedGradientPass {
+        VulkanRecordedPass pass;
+        VkDescriptorSet descriptorSet;
+    };
+    struct RecordedFramePasses {
+        std::vector<RecordedGradientPass> gradients;
+        std::vector<VulkanRecordedPass> blits;
+    };
+    std::vector<RecordedFramePasses> _recordedPasses;
+    RecordedPassStats _recordedPassStats;
+
+    // Per frame resources are indexed by _frameId % _framesInFlight
+    uint32_t _framesInFlight;
+    std::vector<VkCommandBuffer> _commandBuffers;
+    std::vector<VulkanTexture*> _renderTargets;
+    VkExtent2D _renderTargetExtent;
+
+    // The whole frame is the outermost pass
+    Uptr<VulkanGpuProfiler> _gpuProfiler;
+
+    // The gradient pass is replayed from a secondary command buffer, its statistics need the inheritedQueries feature
+    bool _gradientStatistics = false;
+    float _gpuFrameMs = 0.f;
+    double _gpuFrameMsSum = 0.0;
+    uint32_t _gpuFrameCount = 0;
+
+    DynamicResolution _dynamicResolution;
+    // Scale each frame in flight was last rendered at, its GPU time is read back framesInFlight frames later
+    std::vector<float> _frameScales;
+
+    // Filled along the frame, recorded at its end
+    FrameTimings _frameTimings;
+    FramePacing _framePacing;
+
+    // Frame N signals N on completion, frame N waits for N - _framesInFlight before reusing its resources
+    VkSemaphore _frameTimeline;
+
+    std::vector<VkSemaphore> _presentSemaphores;
     std::vector<VkSemaphore> _renderSemaphores;
 
     // TODO: refactor that
     ResourceAllocator<VulkanTexture> _textures;
-    Uptr<VulkanDescriptorSetPool<MaxFramesInFlight>> _descriptorSetPoolCompute = nullptr;
-    Uptr<VulkanPipeline> _computePipeline = nullptr;
-    Uptr<VulkanPipeline> _graphicsPipeline = nullptr;
+    Uptr<VulkanDescriptorSetPool> _descriptorSetPoolCompute = nullptr;
+    Uptr<VulkanPipelineCache> _pipelineCache = nullptr;
+    VulkanPipeline* _computePipeline = nullptr;
+    VulkanPipeline* _graphicsPipeline = nullptr;
+
+    // Synthetic load of the benchmark scenes, see RendererConfig::workload
+    RendererWorkload _workload;
+    std::vector<uint32_t> _streamingSource;
+    std::vector<VulkanBuffer> _streamingBuffers;
+    VulkanTexture* _streamedTexture = nullptr;
+
+    // See RendererConfig::frameCapturePath, the capture is described every frame it is the slowest one so far
+    std::filesystem::path _frameCapturePath;
+    uint32_t _frameCaptureId;
+    FrameCapture _frameCapture;
+
+#if TBD_HUD
+    // nullptr unless RendererConfig::hud is set
+    Uptr<VulkanHud> _hud;
+#endif
+
+    // Low latency mode, present ids are the frame ids
+    bool _lowLatency = false;
+    PFN_vkWaitForPresentKHR _waitForPresent = nullptr;
+    // First present id of the current swapchain
+    uint64_t _swapchainFirstFrameId = 0;
+    std::vector<std::chrono::steady_clock::time_point> _frameStartTimes;
+    FrameLatencyStats _latencyStats;
 
-    mutable uint32_t _frameId = 1;
+    uint32_t _frameId = 1;
 };
 
 } // namespace TBD
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <misc/utils.hpp>
+#include <span>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+// Types of the constexpr tables generated by tools/shader_reflect.cpp at build time, one table per shader in src/renderer/shaders
+
+struct ShaderBinding {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    uint32_t count; // 0 for runtime sized arrays
+};
+
+struct ShaderPushConstantRange {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct ShaderSpecializationConstant {
+    uint32_t id;
+    uint32_t defaultValue;
+};
+
+static constexpr uint32_t InvalidSpecId = TBD_MAX_T(uint32_t);
+
+struct ShaderReflection {
+    const char* name;
+    VkShaderStageFlagBits stage;
+
+    // Empty when the binaries are not embedded (TBD_EMBED_SHADERS=OFF), the module is then loaded from spirvPath
+    std::span<const uint32_t> code;
+    const char* spirvPath;
+
+    std::span<const ShaderBinding> bindings;
+    std::span<const ShaderPushConstantRange> pushConstantRanges;
+    std::span<const ShaderSpecializationConstant> specializationConstants;
+
+    // Only meaningful for compute shaders, the default size when it is driven by specialization constants
+    std::array<uint32_t, 3> workgroupSize;
+    std::array<uint32_t, 3> workgroupSizeSpecIds;
+
+    [[nodiscard]] inline bool hasSpecializableWorkgroupSize() const { return workgroupSizeSpecIds[0] != InvalidSpecId || workgroupSizeSpecIds[1] != InvalidSpecId || workgroupSizeSpecIds[2] != InvalidSpecId; }
+};
+
+}
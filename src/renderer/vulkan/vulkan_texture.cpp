@@ -29,7 +29,7 @@ VulkanTexture::VulkanTexture(VulkanRHI* rhi, VkImage image, VkFormat format, VkE
     }
 }
 
-VulkanTexture::VulkanTexture(VulkanRHI* rhi, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, bool mipmap)
+VulkanTexture::VulkanTexture(VulkanRHI* rhi, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, MemoryCategory category, bool mipmap)
     : _format { format }
     , _extent { extent }
 {
@@ -54,6 +54,7 @@ VulkanTexture::VulkanTexture(VulkanRHI* rhi, VkFormat format, VkExtent3D extent,
     if (vmaCreateImage(rhi->getAllocator(), &imageCreateInfo, &allocCreateInfo, &_image, &_allocation, nullptr) != VK_SUCCESS) {
         TBD_ABORT_VK("VMA image creation failed");
     }
+    rhi->getMemoryTracker().track(_allocation, category);
 
     VkImageViewCreateInfo viewCreateInfo {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -83,6 +84,8 @@ VulkanTexture::VulkanTexture(VulkanTexture&& other)
     other._allocation = nullptr;
     _format = other._format;
     _extent = other._extent;
+    _layout = other._layout;
+    other._layout = VK_IMAGE_LAYOUT_UNDEFINED;
 }
 
 VulkanTexture& VulkanTexture::operator=(VulkanTexture&& other)
@@ -100,6 +103,8 @@ VulkanTexture& VulkanTexture::operator=(VulkanTexture&& other)
     other._allocation = nullptr;
     _format = other._format;
     _extent = other._extent;
+    _layout = other._layout;
+    other._layout = VK_IMAGE_LAYOUT_UNDEFINED;
 
     return *this;
 }
@@ -126,6 +131,7 @@ void VulkanTexture::release(const IRHI& rhi)
     }
 
     if (_image) {
+        vrhi.getMemoryTracker().untrack(_allocation);
         vmaDestroyImage(vrhi.getAllocator(), _image, _allocation);
         _image = nullptr;
         _allocation = nullptr;
@@ -170,15 +176,19 @@ void VulkanTexture::clear(VkCommandBuffer commandBuffer, Color color)
     vkCmdClearColorImage(/*rhi->getCommandBuffer()*/ commandBuffer, _image, VK_IMAGE_LAYOUT_GENERAL, reinterpret_cast<VkClearColorValue*>(&color), 1, &imageRange);
 }
 
-void VulkanTexture::blit(VkCommandBuffer commandBuffer, VulkanTexture& dst)
+void VulkanTexture::blit(VkCommandBuffer commandBuffer, VulkanTexture& dst, VkExtent2D srcExtent, VkFilter filter)
 {
+    if (srcExtent.width == 0 || srcExtent.height == 0) {
+        srcExtent = { getWidth(), getHeight() };
+    }
+
     VkImageBlit imageBlit {
         .srcSubresource = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
             .mipLevel = 0,
             .baseArrayLayer = 0,
             .layerCount = 1 },
-        .srcOffsets = { { 0, 0, 0 }, { static_cast<int32_t>(getWidth()), static_cast<int32_t>(getHeight()), 1 } },
+        .srcOffsets = { { 0, 0, 0 }, { static_cast<int32_t>(srcExtent.width), static_cast<int32_t>(srcExtent.height), 1 } },
         .dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
         .dstOffsets = { { 0, 0, 0 }, { static_cast<int32_t>(dst.getWidth()), static_cast<int32_t>(dst.getHeight()), 1 } },
     };
@@ -190,7 +200,7 @@ void VulkanTexture::blit(VkCommandBuffer commandBuffer, VulkanTexture& dst)
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         1,
         &imageBlit,
-        VK_FILTER_NEAREST);
+        filter);
 }
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <misc/types.hpp>
 #include <misc/utils.hpp>
 #include <renderer/core/rhi_interface.hpp>
+#include <renderer/vulkan/vulkan_memory_tracker.hpp>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_core.h>
@@ -19,7 +20,7 @@ public:
 
     VulkanTexture(VulkanRHI* rhi, VkImage image, VkFormat format, VkExtent3D extent, VkImageAspectFlags aspect);
 
-    VulkanTexture(VulkanRHI* rhi, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, bool mipmap = true);
+    VulkanTexture(VulkanRHI* rhi, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, MemoryCategory category, bool mipmap = true);
 
     VulkanTexture(VulkanTexture&& other);
 
@@ -33,6 +34,8 @@ public:
 
     [[nodiscard]] inline uint32_t getHeight() const { return _extent.height; }
 
+    [[nodiscard]] inline VkImage getVkImage() const { return _image; }
+
     [[nodiscard]] inline VkImageView getView() const { return _view; }
 
     [[nodiscard]] inline VkFormat getFormat() const { return _format; }
@@ -43,7 +46,8 @@ public:
 
     void clear(VkCommandBuffer commandBuffer, Color color);
 
-    void blit(VkCommandBuffer commandBuffer, VulkanTexture& dst);
+    // Scales the top left srcExtent region to the whole destination, an empty srcExtent blits the whole texture
+    void blit(VkCommandBuffer commandBuffer, VulkanTexture& dst, VkExtent2D srcExtent = {}, VkFilter filter = VK_FILTER_NEAREST);
 
 private:
     VkImage _image;
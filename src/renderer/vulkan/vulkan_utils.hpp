@@ -1,10 +1,15 @@
 #pragma once
 
 #include <algorithm>
+#include <charconv>
 #include <cstdint>
 #include <cstring>
 #include <misc/utils.hpp>
+#include <span>
+#include <string>
+#include <string_view>
 #include <sys/types.h>
+#include <tuple>
 #include <unordered_set>
 #include <vector>
 #include <vulkan/vulkan.hpp>
@@ -96,7 +101,279 @@ namespace VKUtils {
         inline bool isValid() const { return GraphicsQueueFamilyID != TBD_MAX_T(uint32_t) && PresentQueueFamilyID != TBD_MAX_T(uint32_t); }
     };
 
-    [[nodiscard]] inline std::pair<VkPhysicalDevice, PhysicalDeviceQueueFamilyID> selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface)
+    // Prefers a family doing both graphics and presentation, without a surface the present queue is the graphics queue
+    [[nodiscard]] inline PhysicalDeviceQueueFamilyID findQueueFamilies(VkPhysicalDevice gpu, VkSurfaceKHR surface)
+    {
+        uint32_t familyCount;
+        vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, nullptr);
+
+        std::vector<VkQueueFamilyProperties> families { familyCount };
+        vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, families.data());
+
+        auto supportsPresent = [gpu, surface](uint32_t familyId) {
+            VkBool32 supported = VK_FALSE;
+            return vkGetPhysicalDeviceSurfaceSupportKHR(gpu, familyId, surface, &supported) == VK_SUCCESS && supported;
+        };
+
+        PhysicalDeviceQueueFamilyID queues {};
+        for (uint32_t familyId = 0; familyId < familyCount; ++familyId) {
+            if (!(families[familyId].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+
+            if (surface == nullptr || supportsPresent(familyId)) {
+                queues.GraphicsQueueFamilyID = familyId;
+                queues.PresentQueueFamilyID = familyId;
+                return queues;
+            }
+
+            if (queues.GraphicsQueueFamilyID == TBD_MAX_T(uint32_t)) {
+                queues.GraphicsQueueFamilyID = familyId;
+            }
+        }
+
+        for (uint32_t familyId = 0; familyId < familyCount && queues.GraphicsQueueFamilyID != TBD_MAX_T(uint32_t); ++familyId) {
+            if (supportsPresent(familyId)) {
+                queues.PresentQueueFamilyID = familyId;
+                break;
+            }
+        }
+
+        return queues;
+    }
+
+    [[nodiscard]] inline bool hasDeviceExtension(VkPhysicalDevice gpu, const char* extensionName)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> extensions { extensionCount };
+        vkEnumerateDeviceExtensionProperties(gpu, nullptr, &extensionCount, extensions.data());
+
+        auto predicate = [extensionName](const VkExtensionProperties& extension) { return std::strcmp(extension.extensionName, extensionName) == 0; };
+        return std::find_if(extensions.cbegin(), extensions.cend(), predicate) != extensions.cend();
+    }
+
+    // Profile of a device, the required features gate its selection and the optional ones pick the engine code paths
+    struct DeviceCapabilities {
+        std::string name;
+        VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+        uint32_t apiVersion = 0;
+        VkDeviceSize deviceLocalMemory = 0;
+
+        // Required, enabled unconditionally by createLogicalDevice
+        bool timelineSemaphore = false;
+        bool synchronization2 = false;
+        bool dynamicRendering = false;
+        bool bufferDeviceAddress = false;
+        bool descriptorIndexing = false;
+
+        // Descriptor indexing limits, bound the size of bindless tables
+        uint32_t maxUpdateAfterBindDescriptorsInAllPools = 0;
+        uint32_t maxPerStageDescriptorUpdateAfterBindSampledImages = 0;
+        uint32_t maxPerStageDescriptorUpdateAfterBindStorageImages = 0;
+
+        // Queue families without graphics, for async copies and compute
+        uint32_t dedicatedTransferQueueFamilyID = TBD_MAX_T(uint32_t);
+        uint32_t dedicatedComputeQueueFamilyID = TBD_MAX_T(uint32_t);
+
+        uint32_t maxImageDimension2D = 0;
+        uint32_t maxComputeSharedMemorySize = 0;
+
+        // Cull mode, front face, topology and depth state, core in Vulkan 1.3
+        bool extendedDynamicState = false;
+        bool dynamicPrimitiveTopologyUnrestricted = false;
+
+        // VK_EXT_extended_dynamic_state3
+        bool extendedDynamicState3 = false;
+        bool extendedDynamicState3PolygonMode = false;
+        bool extendedDynamicState3ColorBlendEnable = false;
+        bool extendedDynamicState3ColorBlendEquation = false;
+        bool extendedDynamicState3ColorWriteMask = false;
+
+        // VK_KHR_present_id and VK_KHR_present_wait
+        bool presentWait = false;
+
+        // Storage images declared without a format, required to store to swapchain images
+        bool storageImageWriteWithoutFormat = false;
+
+        // VK_EXT_memory_budget, the driver reports the heap budgets instead of VMA estimating them
+        bool memoryBudget = false;
+
+        // Shader invocation counts of the GPU profiler passes
+        bool pipelineStatisticsQuery = false;
+
+        // Secondary command buffers can be executed while a query is active
+        bool inheritedQueries = false;
+    };
+
+    [[nodiscard]] inline DeviceCapabilities queryDeviceCapabilities(VkPhysicalDevice gpu)
+    {
+        DeviceCapabilities capabilities {};
+
+        VkPhysicalDeviceVulkan12Properties properties12 {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES
+        };
+        VkPhysicalDeviceProperties2 properties2 {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &properties12
+        };
+        vkGetPhysicalDeviceProperties2(gpu, &properties2);
+        const VkPhysicalDeviceProperties& properties = properties2.properties;
+
+        capabilities.name = properties.deviceName;
+        capabilities.type = properties.deviceType;
+        capabilities.apiVersion = properties.apiVersion;
+        capabilities.extendedDynamicState = properties.apiVersion >= VK_API_VERSION_1_3;
+        capabilities.maxImageDimension2D = properties.limits.maxImageDimension2D;
+        capabilities.maxComputeSharedMemorySize = properties.limits.maxComputeSharedMemorySize;
+        capabilities.maxUpdateAfterBindDescriptorsInAllPools = properties12.maxUpdateAfterBindDescriptorsInAllPools;
+        capabilities.maxPerStageDescriptorUpdateAfterBindSampledImages = properties12.maxPerStageDescriptorUpdateAfterBindSampledImages;
+        capabilities.maxPerStageDescriptorUpdateAfterBindStorageImages = properties12.maxPerStageDescriptorUpdateAfterBindStorageImages;
+
+        if (properties.apiVersion >= VK_API_VERSION_1_3) {
+            VkPhysicalDeviceVulkan12Features features12 {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+            };
+            VkPhysicalDeviceVulkan13Features features13 {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                .pNext = &features12
+            };
+            VkPhysicalDeviceFeatures2 features2 {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &features13
+            };
+            vkGetPhysicalDeviceFeatures2(gpu, &features2);
+
+            capabilities.timelineSemaphore = features12.timelineSemaphore;
+            capabilities.bufferDeviceAddress = features12.bufferDeviceAddress;
+            capabilities.descriptorIndexing = features12.descriptorIndexing;
+            capabilities.synchronization2 = features13.synchronization2;
+            capabilities.dynamicRendering = features13.dynamicRendering;
+        }
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(gpu, &memoryProperties);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+            if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                capabilities.deviceLocalMemory += memoryProperties.memoryHeaps[i].size;
+            }
+        }
+
+        uint32_t familyCount;
+        vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families { familyCount };
+        vkGetPhysicalDeviceQueueFamilyProperties(gpu, &familyCount, families.data());
+
+        for (uint32_t familyId = 0; familyId < familyCount; ++familyId) {
+            const VkQueueFlags flags = families[familyId].queueFlags;
+            if (flags & VK_QUEUE_GRAPHICS_BIT) {
+                continue;
+            }
+
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && capabilities.dedicatedComputeQueueFamilyID == TBD_MAX_T(uint32_t)) {
+                capabilities.dedicatedComputeQueueFamilyID = familyId;
+            } else if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT) && capabilities.dedicatedTransferQueueFamilyID == TBD_MAX_T(uint32_t)) {
+                capabilities.dedicatedTransferQueueFamilyID = familyId;
+            }
+        }
+
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures(gpu, &features);
+        capabilities.storageImageWriteWithoutFormat = features.shaderStorageImageWriteWithoutFormat;
+        capabilities.pipelineStatisticsQuery = features.pipelineStatisticsQuery;
+        capabilities.inheritedQueries = features.inheritedQueries;
+
+        if (hasDeviceExtension(gpu, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+            VkPhysicalDeviceExtendedDynamicState3PropertiesEXT eds3Properties {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_PROPERTIES_EXT
+            };
+            VkPhysicalDeviceProperties2 properties2 {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                .pNext = &eds3Properties
+            };
+            vkGetPhysicalDeviceProperties2(gpu, &properties2);
+
+            VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Features {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT
+            };
+            VkPhysicalDeviceFeatures2 features2 {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &eds3Features
+            };
+            vkGetPhysicalDeviceFeatures2(gpu, &features2);
+
+            capabilities.dynamicPrimitiveTopologyUnrestricted = eds3Properties.dynamicPrimitiveTopologyUnrestricted;
+            capabilities.extendedDynamicState3PolygonMode = eds3Features.extendedDynamicState3PolygonMode;
+            capabilities.extendedDynamicState3ColorBlendEnable = eds3Features.extendedDynamicState3ColorBlendEnable;
+            capabilities.extendedDynamicState3ColorBlendEquation = eds3Features.extendedDynamicState3ColorBlendEquation;
+            capabilities.extendedDynamicState3ColorWriteMask = eds3Features.extendedDynamicState3ColorWriteMask;
+            capabilities.extendedDynamicState3 = capabilities.extendedDynamicState3PolygonMode
+                || capabilities.extendedDynamicState3ColorBlendEnable
+                || capabilities.extendedDynamicState3ColorBlendEquation
+                || capabilities.extendedDynamicState3ColorWriteMask;
+        }
+
+        if (hasDeviceExtension(gpu, VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasDeviceExtension(gpu, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+            VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR
+            };
+            VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+                .pNext = &presentWaitFeatures
+            };
+            VkPhysicalDeviceFeatures2 features2 {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &presentIdFeatures
+            };
+            vkGetPhysicalDeviceFeatures2(gpu, &features2);
+
+            capabilities.presentWait = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+        }
+
+        capabilities.memoryBudget = hasDeviceExtension(gpu, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+        return capabilities;
+    }
+
+    // Negative when a required feature is missing, the device type dominates, then memory, the optional code paths and the limits
+    [[nodiscard]] inline int64_t scorePhysicalDevice(const DeviceCapabilities& capabilities, PhysicalDeviceQueueFamilyID queues)
+    {
+        if (!queues.isValid() || capabilities.apiVersion < VK_API_VERSION_1_3 || !capabilities.timelineSemaphore || !capabilities.synchronization2
+            || !capabilities.dynamicRendering || !capabilities.bufferDeviceAddress || !capabilities.descriptorIndexing) {
+            return -1;
+        }
+
+        // CPU implementations such as lavapipe are only picked when nothing else is usable
+        int64_t typeScore = 0;
+        switch (capabilities.type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            typeScore = 4;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            typeScore = 3;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            typeScore = 2;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            typeScore = 1;
+            break;
+        default:
+            break;
+        }
+
+        const int64_t memoryScore = std::min<int64_t>(capabilities.deviceLocalMemory >> 26, 100'000); // 64MiB units
+        const int64_t featureScore = 1000
+            * (int64_t(capabilities.extendedDynamicState3) + int64_t(capabilities.presentWait) + int64_t(capabilities.storageImageWriteWithoutFormat)
+                + int64_t(capabilities.dedicatedComputeQueueFamilyID != TBD_MAX_T(uint32_t)) + int64_t(capabilities.dedicatedTransferQueueFamilyID != TBD_MAX_T(uint32_t)));
+        const int64_t limitScore = capabilities.maxImageDimension2D / 1024 + capabilities.maxComputeSharedMemorySize / 8192;
+
+        return typeScore * 1'000'000 + memoryScore + featureScore + limitScore;
+    }
+
+    // The preferred device is an index in the enumeration order or a part of its name, the best scored device is used when empty or not usable
+    [[nodiscard]] inline std::pair<VkPhysicalDevice, PhysicalDeviceQueueFamilyID> selectPhysicalDevice(VkInstance instance, VkSurfaceKHR surface, std::string_view preferredDevice = {})
     {
         uint32_t physicalDeviceCount;
         vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
@@ -104,56 +381,80 @@ namespace VKUtils {
         std::vector<VkPhysicalDevice> availableGpus { physicalDeviceCount };
         vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, availableGpus.data());
 
-        PhysicalDeviceQueueFamilyID queues {};
-        std::vector<VkQueueFamilyProperties> queueData { 16 };
+        uint32_t preferredIndex = TBD_MAX_T(uint32_t);
+        const bool preferIndex = !preferredDevice.empty() && std::all_of(preferredDevice.cbegin(), preferredDevice.cend(), [](char c) { return c >= '0' && c <= '9'; });
+        if (preferIndex) {
+            std::from_chars(preferredDevice.data(), preferredDevice.data() + preferredDevice.size(), preferredIndex);
+        }
 
-        std::string selectedDeviceName;
         uint32_t deviceId = TBD_MAX_T(uint32_t);
+        uint32_t preferredDeviceId = TBD_MAX_T(uint32_t);
+        int64_t bestScore = -1;
+        std::string selectedDeviceName;
+        std::string preferredDeviceName;
+        PhysicalDeviceQueueFamilyID selectedQueues {};
+        PhysicalDeviceQueueFamilyID preferredQueues {};
 
         for (uint32_t i = 0; i < physicalDeviceCount; ++i) {
-            VkPhysicalDeviceProperties properties;
-            vkGetPhysicalDeviceProperties(availableGpus[i], &properties);
-
-            if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
-                || (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU && deviceId == TBD_MAX_T(uint32_t))) {
-                uint32_t familyCount;
-                vkGetPhysicalDeviceQueueFamilyProperties(availableGpus[i], &familyCount, nullptr);
-
-                queueData.resize(familyCount);
-                vkGetPhysicalDeviceQueueFamilyProperties(availableGpus[i], &familyCount, queueData.data());
-
-                queues = {};
-                for (int32_t queueId = 0; queueId < familyCount; ++queueId) {
-                    if (queues.GraphicsQueueFamilyID == TBD_MAX_T(decltype(queues.GraphicsQueueFamilyID)) && queueData[queueId].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                        queues.GraphicsQueueFamilyID = queueId;
-                    }
-
-                    if (queues.PresentQueueFamilyID == TBD_MAX_T(decltype(queues.PresentQueueFamilyID))) {
-                        VkBool32 supported;
-                        vkGetPhysicalDeviceSurfaceSupportKHR(availableGpus[i], queueId, surface, &supported);
-                        queues.PresentQueueFamilyID = queueId;
-                    }
-                }
-
-                if (queues.isValid()) {
-                    deviceId = i;
-                    selectedDeviceName = properties.deviceName;
-                }
+            const DeviceCapabilities capabilities = queryDeviceCapabilities(availableGpus[i]);
+            const PhysicalDeviceQueueFamilyID queues = findQueueFamilies(availableGpus[i], surface);
+            const int64_t score = scorePhysicalDevice(capabilities, queues);
+
+            TBD_DEBUG("Vulkan device " << i << " \"" << capabilities.name << "\" " << (score < 0 ? "unusable" : "scored " + std::to_string(score)));
+
+            if (score < 0) {
+                continue;
+            }
+
+            const bool preferred = preferIndex ? i == preferredIndex : !preferredDevice.empty() && capabilities.name.find(preferredDevice) != std::string::npos;
+            if (preferred && preferredDeviceId == TBD_MAX_T(uint32_t)) {
+                preferredDeviceId = i;
+                preferredQueues = queues;
+                preferredDeviceName = capabilities.name;
+            }
+
+            if (score > bestScore) {
+                bestScore = score;
+                deviceId = i;
+                selectedQueues = queues;
+                selectedDeviceName = capabilities.name;
             }
         }
 
+        if (preferredDeviceId != TBD_MAX_T(uint32_t)) {
+            deviceId = preferredDeviceId;
+            selectedQueues = preferredQueues;
+            selectedDeviceName = preferredDeviceName;
+        } else if (!preferredDevice.empty()) {
+            TBD_WARN("No usable Vulkan device matches \"" << preferredDevice << "\", using the best scored one");
+        }
+
         if (deviceId == TBD_MAX_T(uint32_t)) {
             TBD_ABORT_VK("Couldn't find a suitable physical device");
         }
 
-        VkPhysicalDevice gpu = availableGpus[deviceId];
-
         TBD_LOG("Selected Vulkan device: " << selectedDeviceName);
 
-        return { availableGpus[deviceId], queues };
+        return { availableGpus[deviceId], selectedQueues };
     }
 
-    [[nodiscard]] inline VkDevice createLogicalDevice(VkPhysicalDevice gpu, PhysicalDeviceQueueFamilyID queues)
+    inline void logDeviceCapabilities(const DeviceCapabilities& capabilities)
+    {
+        TBD_LOG("Device profile: " << (capabilities.deviceLocalMemory >> 20) << "MiB device local, " << capabilities.maxImageDimension2D << " max 2D image dimension");
+        TBD_LOG("  Dynamic state: extended " << capabilities.extendedDynamicState << ", extended 3 " << capabilities.extendedDynamicState3
+                                             << ", unrestricted topology " << capabilities.dynamicPrimitiveTopologyUnrestricted);
+        TBD_LOG("  Descriptor indexing: " << capabilities.maxUpdateAfterBindDescriptorsInAllPools << " update after bind descriptors, "
+                                          << capabilities.maxPerStageDescriptorUpdateAfterBindSampledImages << " sampled and "
+                                          << capabilities.maxPerStageDescriptorUpdateAfterBindStorageImages << " storage images per stage");
+        TBD_LOG("  Dedicated queues: compute " << (capabilities.dedicatedComputeQueueFamilyID != TBD_MAX_T(uint32_t))
+                                               << ", transfer " << (capabilities.dedicatedTransferQueueFamilyID != TBD_MAX_T(uint32_t)));
+        TBD_LOG("  Present wait " << capabilities.presentWait << ", storage write without format " << capabilities.storageImageWriteWithoutFormat
+                                  << ", memory budget " << capabilities.memoryBudget << ", pipeline statistics " << capabilities.pipelineStatisticsQuery
+                                  << ", inherited queries " << capabilities.inheritedQueries);
+    }
+
+    // Without presentation, for headless rendering, no swapchain extension is enabled
+    [[nodiscard]] inline VkDevice createLogicalDevice(VkPhysicalDevice gpu, PhysicalDeviceQueueFamilyID queues, const DeviceCapabilities& capabilities = {}, bool presentation = true)
     {
         std::unordered_set<uint32_t> queueIndices { queues.GraphicsQueueFamilyID, queues.PresentQueueFamilyID };
 
@@ -170,10 +471,15 @@ namespace VKUtils {
             queuesCreateInfo.emplace_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures features {};
+        VkPhysicalDeviceFeatures features {
+            .pipelineStatisticsQuery = capabilities.pipelineStatisticsQuery,
+            .shaderStorageImageWriteWithoutFormat = capabilities.storageImageWriteWithoutFormat,
+            .inheritedQueries = capabilities.inheritedQueries
+        };
         VkPhysicalDeviceVulkan12Features features12 {
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
             .descriptorIndexing = VK_TRUE,
+            .timelineSemaphore = VK_TRUE,
             .bufferDeviceAddress = VK_TRUE
         };
         VkPhysicalDeviceVulkan13Features features13 {
@@ -182,16 +488,52 @@ namespace VKUtils {
             .synchronization2 = VK_TRUE,
             .dynamicRendering = VK_TRUE
         };
+        void* featuresChain = &features13;
+
+        VkPhysicalDeviceExtendedDynamicState3FeaturesEXT eds3Features {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+            .pNext = featuresChain,
+            .extendedDynamicState3PolygonMode = capabilities.extendedDynamicState3PolygonMode,
+            .extendedDynamicState3ColorBlendEnable = capabilities.extendedDynamicState3ColorBlendEnable,
+            .extendedDynamicState3ColorBlendEquation = capabilities.extendedDynamicState3ColorBlendEquation,
+            .extendedDynamicState3ColorWriteMask = capabilities.extendedDynamicState3ColorWriteMask
+        };
 
-        const char* swapchainExt = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+        std::vector<const char*> extensions;
+        if (presentation) {
+            extensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+        if (capabilities.extendedDynamicState3) {
+            extensions.emplace_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+            featuresChain = &eds3Features;
+        }
+        if (capabilities.memoryBudget) {
+            extensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = featuresChain,
+            .presentId = VK_TRUE
+        };
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+            .pNext = &presentIdFeatures,
+            .presentWait = VK_TRUE
+        };
+        if (presentation && capabilities.presentWait) {
+            extensions.emplace_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            extensions.emplace_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            featuresChain = &presentWaitFeatures;
+        }
 
         VkDeviceCreateInfo deviceCreateInfo {
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-            .pNext = &features13,
+            .pNext = featuresChain,
             .queueCreateInfoCount = static_cast<uint32_t>(queuesCreateInfo.size()),
             .pQueueCreateInfos = queuesCreateInfo.data(),
-            .enabledExtensionCount = 1,
-            .ppEnabledExtensionNames = &swapchainExt,
+            .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+            .ppEnabledExtensionNames = extensions.data(),
             .pEnabledFeatures = &features
         };
 
@@ -205,47 +547,115 @@ namespace VKUtils {
         return device;
     }
 
-    [[nodiscard]] inline std::pair<VkSwapchainKHR, VkFormat> createSwapchain(VkDevice device, VkPhysicalDevice gpu, VkSurfaceKHR surface, PhysicalDeviceQueueFamilyID queues, VkExtent2D extent, VkSwapchainKHR previousSwapchain = nullptr)
+    // Falls back to the closest supported mode, FIFO is always available
+    [[nodiscard]] inline VkPresentModeKHR selectPresentMode(VkPhysicalDevice gpu, VkSurfaceKHR surface, VkPresentModeKHR preferredMode)
     {
-        VkSurfaceCapabilitiesKHR surfaceCapabilities;
-        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu, surface, &surfaceCapabilities);
+        uint32_t modeCount;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(gpu, surface, &modeCount, nullptr);
+
+        std::vector<VkPresentModeKHR> modes { modeCount };
+        vkGetPhysicalDeviceSurfacePresentModesKHR(gpu, surface, &modeCount, modes.data());
+
+        std::vector<VkPresentModeKHR> candidates;
+        switch (preferredMode) {
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            candidates = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+            break;
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            candidates = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+            break;
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            candidates = { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+            break;
+        default:
+            break;
+        }
 
+        for (VkPresentModeKHR candidate : candidates) {
+            if (std::find(modes.cbegin(), modes.cend(), candidate) != modes.cend()) {
+                return candidate;
+            }
+        }
+
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    // sRGB formats can't be stored to, storage swapchains use a UNORM format and the shaders writing to it encode the colors
+    [[nodiscard]] inline VkFormat selectSurfaceFormat(VkPhysicalDevice gpu, VkSurfaceKHR surface, bool storage = false)
+    {
         uint32_t formatsCount;
         vkGetPhysicalDeviceSurfaceFormatsKHR(gpu, surface, &formatsCount, nullptr);
 
         std::vector<VkSurfaceFormatKHR> surfaceFormats { formatsCount };
         vkGetPhysicalDeviceSurfaceFormatsKHR(gpu, surface, &formatsCount, surfaceFormats.data());
 
-        VkFormat preferredFormats[] = {
+        const VkFormat srgbFormats[] = {
             VK_FORMAT_R8G8B8A8_SRGB,
             VK_FORMAT_B8G8R8A8_SRGB
         };
+        const VkFormat storageFormats[] = {
+            VK_FORMAT_R8G8B8A8_UNORM,
+            VK_FORMAT_B8G8R8A8_UNORM
+        };
 
-        uint32_t formatId = 0;
-        for (; formatId < sizeof(preferredFormats); ++formatId) {
-            VkFormat format = preferredFormats[formatId];
-            auto predicate = [format](VkSurfaceFormatKHR surfaceFormat) { return surfaceFormat.format == format; };
-            if (std::find_if(surfaceFormats.cbegin(), surfaceFormats.cend(), predicate) != surfaceFormats.cend()) {
-                break;
+        for (VkFormat format : storage ? std::span<const VkFormat> { storageFormats } : std::span<const VkFormat> { srgbFormats }) {
+            auto predicate = [format](VkSurfaceFormatKHR surfaceFormat) { return surfaceFormat.format == format && surfaceFormat.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR; };
+            if (std::find_if(surfaceFormats.cbegin(), surfaceFormats.cend(), predicate) == surfaceFormats.cend()) {
+                continue;
+            }
+
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(gpu, format, &properties);
+            if (!storage || (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+                return format;
             }
         }
 
-        if (formatId == sizeof(preferredFormats)) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    [[nodiscard]] inline bool supportsStorageSwapchain(VkPhysicalDevice gpu, VkSurfaceKHR surface)
+    {
+        VkSurfaceCapabilitiesKHR surfaceCapabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu, surface, &surfaceCapabilities);
+
+        return (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT) && selectSurfaceFormat(gpu, surface, true) != VK_FORMAT_UNDEFINED;
+    }
+
+    // With storage the images can be written by compute shaders, see selectSurfaceFormat
+    // The requested extent is clamped to what the surface allows, which can lag behind the window while it is resized,
+    // the extent actually used is returned
+    [[nodiscard]] inline std::tuple<VkSwapchainKHR, VkFormat, VkExtent2D> createSwapchain(VkDevice device, VkPhysicalDevice gpu, VkSurfaceKHR surface, PhysicalDeviceQueueFamilyID queues, VkExtent2D extent,
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR, VkSwapchainKHR previousSwapchain = nullptr, bool storage = false)
+    {
+        VkSurfaceCapabilitiesKHR surfaceCapabilities;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu, surface, &surfaceCapabilities);
+
+        const VkFormat format = selectSurfaceFormat(gpu, surface, storage);
+        if (format == VK_FORMAT_UNDEFINED) {
             TBD_ABORT_VK("Couldn't find a supported surface format");
         }
 
+        // A current extent of 0xFFFFFFFF lets the swapchain decide
+        const VkExtent2D imageExtent = surfaceCapabilities.currentExtent.width != TBD_MAX_T(uint32_t)
+            ? surfaceCapabilities.currentExtent
+            : VkExtent2D {
+                  std::clamp(extent.width, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width),
+                  std::clamp(extent.height, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height)
+              };
+
         VkSwapchainCreateInfoKHR swapchainCreateInfo {
             .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
             .surface = surface,
             .minImageCount = surfaceCapabilities.maxImageCount > 0 && surfaceCapabilities.minImageCount + 1 > surfaceCapabilities.maxImageCount ? surfaceCapabilities.maxImageCount : surfaceCapabilities.minImageCount + 1,
-            .imageFormat = preferredFormats[formatId],
+            .imageFormat = format,
             .imageColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR,
-            .imageExtent = extent,
+            .imageExtent = imageExtent,
             .imageArrayLayers = 1,
-            .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (storage ? VK_IMAGE_USAGE_STORAGE_BIT : 0u),
             .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
             .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-            .presentMode = VK_PRESENT_MODE_FIFO_KHR,
+            .presentMode = presentMode,
             .clipped = VK_TRUE,
             .oldSwapchain = previousSwapchain
         };
@@ -266,14 +676,15 @@ namespace VKUtils {
             TBD_ABORT_VK("Vulkan swapchain creation failed");
         }
 
-        return { swapchain, preferredFormats[formatId] };
+        return { swapchain, format, imageExtent };
     }
 
-    [[nodiscard]] inline VkCommandPool createCommandPool(VkDevice device, uint32_t queueFamilyIndex)
+    // Per frame pools are created transient without individual resets and reset in bulk with vkResetCommandPool
+    [[nodiscard]] inline VkCommandPool createCommandPool(VkDevice device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)
     {
         VkCommandPoolCreateInfo commandPoolCreateInfo {
             .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .flags = flags,
             .queueFamilyIndex = queueFamilyIndex
         };
 
@@ -285,12 +696,12 @@ namespace VKUtils {
         return commandPool;
     }
 
-    inline void allocateCommandBuffers(VkDevice device, VkCommandPool commandPool, uint32_t bufferCount, VkCommandBuffer* buffers)
+    inline void allocateCommandBuffers(VkDevice device, VkCommandPool commandPool, uint32_t bufferCount, VkCommandBuffer* buffers, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY)
     {
         VkCommandBufferAllocateInfo cbAllocInfo {
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
             .commandPool = commandPool,
-            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .level = level,
             .commandBufferCount = bufferCount
         };
 
@@ -313,6 +724,56 @@ namespace VKUtils {
         return semaphore;
     }
 
+    [[nodiscard]] inline VkSemaphore createTimelineSemaphore(VkDevice device, uint64_t initialValue = 0)
+    {
+        VkSemaphoreTypeCreateInfo typeCreateInfo {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = initialValue
+        };
+        VkSemaphoreCreateInfo semCreateInfo {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &typeCreateInfo
+        };
+
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(device, &semCreateInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            TBD_ABORT_VK("Failed to create Vulkan timeline semaphore");
+        }
+
+        return semaphore;
+    }
+
+    // Blocks until the timeline semaphore reaches value
+    [[nodiscard]] inline VkResult waitTimelineSemaphore(VkDevice device, VkSemaphore semaphore, uint64_t value, uint64_t timeout = TBD_MAX_T(uint64_t))
+    {
+        VkSemaphoreWaitInfo waitInfo {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &semaphore,
+            .pValues = &value
+        };
+
+        return vkWaitSemaphores(device, &waitInfo, timeout);
+    }
+
+    [[nodiscard]] inline VkQueryPool createQueryPool(VkDevice device, VkQueryType type, uint32_t queryCount, VkQueryPipelineStatisticFlags pipelineStatistics = 0)
+    {
+        VkQueryPoolCreateInfo queryPoolCreateInfo {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = type,
+            .queryCount = queryCount,
+            .pipelineStatistics = pipelineStatistics
+        };
+
+        VkQueryPool queryPool;
+        if (vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool) != VK_SUCCESS) {
+            TBD_ABORT_VK("Failed to create Vulkan query pool");
+        }
+
+        return queryPool;
+    }
+
     [[nodiscard]] inline VkFence createFence(VkDevice device)
     {
         VkFenceCreateInfo fenceCreateInfo {
@@ -352,12 +813,13 @@ namespace VKUtils {
         };
     }
 
-    [[nodiscard]] inline VkSemaphoreSubmitInfo makeSemaphoreSubmitInfo(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask)
+    // The value is ignored for binary semaphores
+    [[nodiscard]] inline VkSemaphoreSubmitInfo makeSemaphoreSubmitInfo(VkSemaphore semaphore, VkPipelineStageFlags2 stageMask, uint64_t value = 1)
     {
         return {
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
             .semaphore = semaphore,
-            .value = 1,
+            .value = value,
             .stageMask = stageMask,
             .deviceIndex = 0
         };
@@ -384,10 +846,32 @@ namespace VKUtils {
         vkQueueSubmit2(queue, 1, &submitInfo, fence);
     }
 
-    inline VmaAllocator createVMAAllocator(VkInstance instance, VkPhysicalDevice gpu, VkDevice device)
+    inline void submitCommandBuffer(VkQueue queue, std::span<const VkSemaphoreSubmitInfo> waitSemaphores, std::span<const VkSemaphoreSubmitInfo> signalSemaphores, VkCommandBuffer commandBuffer, VkFence fence = nullptr)
+    {
+        VkCommandBufferSubmitInfo cbSubmitInfo {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+            .commandBuffer = commandBuffer,
+            .deviceMask = 0
+        };
+
+        VkSubmitInfo2 submitInfo {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .waitSemaphoreInfoCount = static_cast<uint32_t>(waitSemaphores.size()),
+            .pWaitSemaphoreInfos = waitSemaphores.data(),
+            .commandBufferInfoCount = commandBuffer ? 1u : 0u,
+            .pCommandBufferInfos = &cbSubmitInfo,
+            .signalSemaphoreInfoCount = static_cast<uint32_t>(signalSemaphores.size()),
+            .pSignalSemaphoreInfos = signalSemaphores.data()
+        };
+
+        vkQueueSubmit2(queue, 1, &submitInfo, fence);
+    }
+
+    // The device must have been created with the same capabilities, buffer device address is always enabled
+    inline VmaAllocator createVMAAllocator(VkInstance instance, VkPhysicalDevice gpu, VkDevice device, const DeviceCapabilities& capabilities = {})
     {
         VmaAllocatorCreateInfo allocatorCreateInfo {
-            .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+            .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT | (capabilities.memoryBudget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0u),
             .physicalDevice = gpu,
             .device = device,
             .instance = instance,
@@ -0,0 +1,80 @@
+#include "vulkan_workgroup_profile.hpp"
+#include <fstream>
+#include <ios>
+#include <misc/utils.hpp>
+#include <sstream>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+std::filesystem::path VulkanWorkgroupProfile::getPath(VkPhysicalDevice gpu)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(gpu, &properties);
+
+    std::stringstream fileName;
+    fileName << std::hex << properties.vendorID << "_" << properties.deviceID << "_" << properties.driverVersion << ".workgroups";
+
+    return std::filesystem::path { PROJECT_DIR ".cache/profiles" } / fileName.str();
+}
+
+bool VulkanWorkgroupProfile::load(const std::filesystem::path& path)
+{
+    std::ifstream file { path };
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string name;
+    Vec3u workgroupSize;
+    while (file >> name >> workgroupSize.x >> workgroupSize.y >> workgroupSize.z) {
+        _workgroupSizes[name] = workgroupSize;
+    }
+
+    TBD_LOG("Loaded " << _workgroupSizes.size() << " workgroup sizes from " << path);
+
+    return true;
+}
+
+bool VulkanWorkgroupProfile::save(const std::filesystem::path& path) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    std::ofstream file { path };
+    if (!file.is_open()) {
+        TBD_WARN("Failed to write the workgroup profile to " << path);
+        return false;
+    }
+
+    for (const auto& [name, workgroupSize] : _workgroupSizes) {
+        file << name << " " << workgroupSize.x << " " << workgroupSize.y << " " << workgroupSize.z << "\n";
+    }
+
+    return true;
+}
+
+Vec3u VulkanWorkgroupProfile::getWorkgroupSize(const ShaderReflection& shader) const
+{
+    Vec3u workgroupSize { 0 };
+
+    auto it = _workgroupSizes.find(shader.name);
+    if (it == _workgroupSizes.end()) {
+        return workgroupSize;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (shader.workgroupSizeSpecIds[i] != InvalidSpecId) {
+            workgroupSize[i] = it->second[i];
+        }
+    }
+
+    return workgroupSize;
+}
+
+void VulkanWorkgroupProfile::setWorkgroupSize(const ShaderReflection& shader, Vec3u workgroupSize)
+{
+    _workgroupSizes[shader.name] = workgroupSize;
+}
+
+}
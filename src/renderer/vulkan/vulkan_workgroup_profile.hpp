@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <misc/types.hpp>
+#include <misc/utils.hpp>
+#include <renderer/vulkan/vulkan_shader_reflection.hpp>
+#include <string>
+#include <unordered_map>
+#include <vulkan/vulkan_core.h>
+
+namespace TBD {
+
+// Fastest workgroup size of each compute shader on a given device, produced by the TBD_workgroup_tune benchmark
+class VulkanWorkgroupProfile {
+    TBD_NO_COPY_MOVE(VulkanWorkgroupProfile)
+public:
+    VulkanWorkgroupProfile() = default;
+
+    // One profile per device and driver version
+    [[nodiscard]] static std::filesystem::path getPath(VkPhysicalDevice gpu);
+
+    bool load(const std::filesystem::path& path);
+
+    bool save(const std::filesystem::path& path) const;
+
+    // Returns 0 for the dimensions that were not profiled or can't be specialized, which keeps the reflected default in PipelineShaderData
+    [[nodiscard]] Vec3u getWorkgroupSize(const ShaderReflection& shader) const;
+
+    void setWorkgroupSize(const ShaderReflection& shader, Vec3u workgroupSize);
+
+private:
+    std::unordered_map<std::string, Vec3u> _workgroupSizes;
+};
+
+}
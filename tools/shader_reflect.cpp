@@ -0,0 +1,565 @@
+// Build time SPIR-V reflection, emits a header with the descriptor bindings, push constant ranges, specialization constants
+// and workgroup size of a shader as constexpr tables (see src/renderer/vulkan/vulkan_shader_reflection.hpp), and optionally the binary itself
+//
+// Usage: shader_reflect <input.spv> <output.hpp> <SymbolName> [--embed]
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SpirvMagic = 0x07230203;
+
+enum Op : uint32_t {
+    OpEntryPoint = 15,
+    OpExecutionMode = 16,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpConstantComposite = 44,
+    OpSpecConstantTrue = 48,
+    OpSpecConstantFalse = 49,
+    OpSpecConstant = 50,
+    OpSpecConstantComposite = 51,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+    OpExecutionModeId = 331,
+    OpTypeAccelerationStructureKHR = 5341,
+};
+
+enum Decoration : uint32_t {
+    DecorationSpecId = 1,
+    DecorationBlock = 2,
+    DecorationBufferBlock = 3,
+    DecorationArrayStride = 6,
+    DecorationMatrixStride = 7,
+    DecorationBuiltIn = 11,
+    DecorationBinding = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t {
+    StorageClassUniformConstant = 0,
+    StorageClassUniform = 2,
+    StorageClassPushConstant = 9,
+    StorageClassStorageBuffer = 12,
+};
+
+constexpr uint32_t BuiltInWorkgroupSize = 25;
+constexpr uint32_t ExecutionModeLocalSize = 17;
+constexpr uint32_t ExecutionModeLocalSizeId = 38;
+constexpr uint32_t ExecutionModelGLCompute = 5;
+
+struct Type {
+    uint32_t op = 0;
+    std::vector<uint32_t> operands;
+};
+
+struct Binding {
+    uint32_t set;
+    uint32_t binding;
+    std::string type;
+    uint32_t count;
+};
+
+class Module {
+public:
+    explicit Module(std::vector<uint32_t> words)
+        : _words { std::move(words) }
+    {
+    }
+
+    bool parse()
+    {
+        if (_words.size() < 5 || _words[0] != SpirvMagic) {
+            std::cerr << "Invalid SPIR-V header" << std::endl;
+            return false;
+        }
+
+        for (size_t i = 5; i < _words.size();) {
+            const uint32_t wordCount = _words[i] >> 16;
+            const uint32_t op = _words[i] & 0xFFFF;
+
+            if (wordCount == 0 || i + wordCount > _words.size()) {
+                std::cerr << "Truncated SPIR-V instruction" << std::endl;
+                return false;
+            }
+
+            parseInstruction(op, &_words[i + 1], wordCount - 1);
+            i += wordCount;
+        }
+
+        if (!_stage) {
+            return false;
+        }
+
+        // A default of 1x1x1 would make the dispatches launch one group per invocation
+        if (*_stage == ExecutionModelGLCompute && !collectWorkgroupSize()) {
+            std::cerr << "Compute shader without a resolvable workgroup size" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    void emit(std::ostream& out, const std::string& symbol, const std::filesystem::path& spirvPath, bool embed) const
+    {
+        const std::vector<Binding> bindings = collectBindings();
+        const std::optional<std::pair<uint32_t, uint32_t>> pushConstants = collectPushConstants();
+        const std::vector<std::pair<uint32_t, uint32_t>> specializationConstants = collectSpecializationConstants();
+        const std::array<uint32_t, 3> workgroupSize = collectWorkgroupSize().value_or(std::array<uint32_t, 3> { 1, 1, 1 });
+        const std::array<std::string, 3> workgroupSizeSpecIds = collectWorkgroupSizeSpecIds();
+
+        out << "// Generated by tools/shader_reflect.cpp from " << spirvPath.filename().generic_string() << ", do not edit\n"
+            << "#pragma once\n\n"
+            << "#include <renderer/vulkan/vulkan_shader_reflection.hpp>\n\n"
+            << "namespace TBD::Shaders {\n\n"
+            << "namespace Detail" << symbol << " {\n";
+
+        if (embed) {
+            out << "    inline constexpr uint32_t Code[] = {";
+            for (size_t i = 0; i < _words.size(); ++i) {
+                out << (i % 8 == 0 ? "\n        " : " ") << "0x" << std::hex << _words[i] << std::dec << "u,";
+            }
+            out << "\n    };\n";
+        }
+
+        if (!bindings.empty()) {
+            out << "    inline constexpr ShaderBinding Bindings[] = {\n";
+            for (const Binding& binding : bindings) {
+                out << "        { " << binding.set << ", " << binding.binding << ", " << binding.type << ", " << binding.count << " },\n";
+            }
+            out << "    };\n";
+        }
+
+        if (pushConstants) {
+            out << "    inline constexpr ShaderPushConstantRange PushConstantRanges[] = {\n"
+                << "        { " << pushConstants->first << ", " << pushConstants->second << " },\n"
+                << "    };\n";
+        }
+
+        if (!specializationConstants.empty()) {
+            out << "    inline constexpr ShaderSpecializationConstant SpecializationConstants[] = {\n";
+            for (auto [id, defaultValue] : specializationConstants) {
+                out << "        { " << id << ", " << defaultValue << " },\n";
+            }
+            out << "    };\n";
+        }
+
+        out << "}\n\n"
+            << "inline constexpr ShaderReflection " << symbol << " {\n"
+            << "    .name = \"" << symbol << "\",\n"
+            << "    .stage = " << stageName() << ",\n"
+            << "    .code = " << (embed ? "Detail" + symbol + "::Code" : "{}") << ",\n"
+            << "    .spirvPath = \"" << spirvPath.generic_string() << "\",\n"
+            << "    .bindings = " << (bindings.empty() ? "{}" : "Detail" + symbol + "::Bindings") << ",\n"
+            << "    .pushConstantRanges = " << (pushConstants ? "Detail" + symbol + "::PushConstantRanges" : "{}") << ",\n"
+            << "    .specializationConstants = " << (specializationConstants.empty() ? "{}" : "Detail" + symbol + "::SpecializationConstants") << ",\n"
+            << "    .workgroupSize = { " << workgroupSize[0] << ", " << workgroupSize[1] << ", " << workgroupSize[2] << " },\n"
+            << "    .workgroupSizeSpecIds = { " << workgroupSizeSpecIds[0] << ", " << workgroupSizeSpecIds[1] << ", " << workgroupSizeSpecIds[2] << " }\n"
+            << "};\n\n"
+            << "}\n";
+    }
+
+private:
+    void parseInstruction(uint32_t op, const uint32_t* operands, uint32_t count)
+    {
+        switch (op) {
+        case OpEntryPoint:
+            if (!_stage) {
+                _stage = operands[0];
+            }
+            break;
+        case OpExecutionMode:
+            if (operands[1] == ExecutionModeLocalSize && count >= 5) {
+                _localSize = { operands[2], operands[3], operands[4] };
+            }
+            break;
+        case OpExecutionModeId:
+            // Ids of constants or specialization constants, the SPIR-V 1.6 form of spec constant local sizes
+            if (operands[1] == ExecutionModeLocalSizeId && count >= 5) {
+                _localSizeIds = { operands[2], operands[3], operands[4] };
+            }
+            break;
+        case OpTypeInt:
+        case OpTypeFloat:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeImage:
+        case OpTypeSampler:
+        case OpTypeSampledImage:
+        case OpTypeArray:
+        case OpTypeRuntimeArray:
+        case OpTypeStruct:
+        case OpTypePointer:
+        case OpTypeAccelerationStructureKHR:
+            _types[operands[0]] = Type { op, std::vector<uint32_t>(operands + 1, operands + count) };
+            break;
+        case OpConstant:
+        case OpSpecConstant:
+            if (count >= 3) {
+                _constants[operands[1]] = operands[2];
+            }
+            break;
+        case OpSpecConstantTrue:
+        case OpSpecConstantFalse:
+            _constants[operands[1]] = op == OpSpecConstantTrue ? 1 : 0;
+            break;
+        case OpConstantComposite:
+        case OpSpecConstantComposite:
+            _composites[operands[1]] = std::vector<uint32_t>(operands + 2, operands + count);
+            break;
+        case OpVariable:
+            _variables.emplace_back(operands[1], operands[0], operands[2]);
+            break;
+        case OpDecorate:
+            _decorations[operands[0]][operands[1]] = count > 2 ? operands[2] : 0;
+            break;
+        case OpMemberDecorate:
+            _memberDecorations[operands[0]][operands[1]][operands[2]] = count > 3 ? operands[3] : 0;
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::optional<uint32_t> decoration(uint32_t id, uint32_t decoration) const
+    {
+        auto it = _decorations.find(id);
+        if (it == _decorations.end()) {
+            return std::nullopt;
+        }
+
+        auto decorationIt = it->second.find(decoration);
+        return decorationIt != it->second.end() ? std::optional { decorationIt->second } : std::nullopt;
+    }
+
+    std::optional<uint32_t> memberDecoration(uint32_t id, uint32_t member, uint32_t decoration) const
+    {
+        auto it = _memberDecorations.find(id);
+        if (it == _memberDecorations.end()) {
+            return std::nullopt;
+        }
+
+        auto memberIt = it->second.find(member);
+        if (memberIt == it->second.end()) {
+            return std::nullopt;
+        }
+
+        auto decorationIt = memberIt->second.find(decoration);
+        return decorationIt != memberIt->second.end() ? std::optional { decorationIt->second } : std::nullopt;
+    }
+
+    const Type& type(uint32_t id) const
+    {
+        static const Type Unknown {};
+        auto it = _types.find(id);
+        return it != _types.end() ? it->second : Unknown;
+    }
+
+    // Size in bytes following the explicit layout decorations, matrixStride comes from the enclosing struct member
+    uint32_t typeSize(uint32_t id, uint32_t matrixStride = 0) const
+    {
+        const Type& t = type(id);
+
+        switch (t.op) {
+        case OpTypeInt:
+        case OpTypeFloat:
+            return t.operands[0] / 8;
+        case OpTypeVector:
+            return typeSize(t.operands[0]) * t.operands[1];
+        case OpTypeMatrix:
+            return (matrixStride != 0 ? matrixStride : typeSize(t.operands[0])) * t.operands[1];
+        case OpTypeArray: {
+            const uint32_t stride = decoration(id, DecorationArrayStride).value_or(typeSize(t.operands[0], matrixStride));
+            return stride * _constants.at(t.operands[1]);
+        }
+        case OpTypeStruct: {
+            uint32_t size = 0;
+            for (uint32_t member = 0; member < t.operands.size(); ++member) {
+                const uint32_t offset = memberDecoration(id, member, DecorationOffset).value_or(size);
+                const uint32_t stride = memberDecoration(id, member, DecorationMatrixStride).value_or(0);
+                size = std::max(size, offset + typeSize(t.operands[member], stride));
+            }
+            return size;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    std::string descriptorType(uint32_t typeId, uint32_t storageClass, uint32_t& count) const
+    {
+        const Type* t = &type(typeId);
+
+        count = 1;
+        while (t->op == OpTypeArray || t->op == OpTypeRuntimeArray) {
+            count *= t->op == OpTypeArray ? _constants.at(t->operands[1]) : 0;
+            typeId = t->operands[0];
+            t = &type(typeId);
+        }
+
+        if (storageClass == StorageClassStorageBuffer) {
+            return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER";
+        }
+
+        if (storageClass == StorageClassUniform) {
+            return decoration(typeId, DecorationBufferBlock) ? "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER" : "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER";
+        }
+
+        switch (t->op) {
+        case OpTypeSampler:
+            return "VK_DESCRIPTOR_TYPE_SAMPLER";
+        case OpTypeSampledImage:
+            return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER";
+        case OpTypeAccelerationStructureKHR:
+            return "VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR";
+        case OpTypeImage: {
+            // Operands: sampled type, dim, depth, arrayed, ms, sampled, format
+            const uint32_t dim = t->operands[1];
+            const bool storage = t->operands[5] == 2;
+            if (dim == 5) {
+                return storage ? "VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER" : "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER";
+            }
+            if (dim == 6) {
+                return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT";
+            }
+            return storage ? "VK_DESCRIPTOR_TYPE_STORAGE_IMAGE" : "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE";
+        }
+        default:
+            return {};
+        }
+    }
+
+    std::vector<Binding> collectBindings() const
+    {
+        std::vector<Binding> bindings;
+
+        for (auto [id, pointerType, storageClass] : _variables) {
+            if (storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform && storageClass != StorageClassStorageBuffer) {
+                continue;
+            }
+
+            const std::optional<uint32_t> set = decoration(id, DecorationDescriptorSet);
+            const std::optional<uint32_t> binding = decoration(id, DecorationBinding);
+            if (!set || !binding) {
+                continue;
+            }
+
+            uint32_t count;
+            std::string descType = descriptorType(type(pointerType).operands[1], storageClass, count);
+            if (descType.empty()) {
+                std::cerr << "Unsupported descriptor type at set " << *set << " binding " << *binding << std::endl;
+                continue;
+            }
+
+            bindings.emplace_back(Binding { *set, *binding, std::move(descType), count });
+        }
+
+        std::sort(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b) { return a.set != b.set ? a.set < b.set : a.binding < b.binding; });
+
+        return bindings;
+    }
+
+    // Offset and size of the push constant block, the offset being the one of its first member
+    std::optional<std::pair<uint32_t, uint32_t>> collectPushConstants() const
+    {
+        for (auto [id, pointerType, storageClass] : _variables) {
+            if (storageClass != StorageClassPushConstant) {
+                continue;
+            }
+
+            const uint32_t structId = type(pointerType).operands[1];
+            const Type& structType = type(structId);
+
+            uint32_t offset = std::numeric_limits<uint32_t>::max();
+            for (uint32_t member = 0; member < structType.operands.size(); ++member) {
+                offset = std::min(offset, memberDecoration(structId, member, DecorationOffset).value_or(0));
+            }
+            offset = structType.operands.empty() ? 0 : offset;
+
+            return std::pair { offset, typeSize(structId) - offset };
+        }
+
+        return std::nullopt;
+    }
+
+    // Spec id and default value, 64 bit constants are not supported
+    std::vector<std::pair<uint32_t, uint32_t>> collectSpecializationConstants() const
+    {
+        std::vector<std::pair<uint32_t, uint32_t>> constants;
+
+        for (const auto& [id, decorations] : _decorations) {
+            auto it = decorations.find(DecorationSpecId);
+            if (it != decorations.end() && _constants.contains(id)) {
+                constants.emplace_back(it->second, _constants.at(id));
+            }
+        }
+
+        std::sort(constants.begin(), constants.end());
+
+        return constants;
+    }
+
+    std::optional<uint32_t> workgroupSizeId() const
+    {
+        for (const auto& [id, decorations] : _decorations) {
+            auto it = decorations.find(DecorationBuiltIn);
+            if (it != decorations.end() && it->second == BuiltInWorkgroupSize && _composites.contains(id)) {
+                return id;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    // Constant ids of the workgroup size components, from the WorkgroupSize built-in or the LocalSizeId execution mode
+    std::optional<std::array<uint32_t, 3>> workgroupSizeComponentIds() const
+    {
+        if (const std::optional<uint32_t> id = workgroupSizeId()) {
+            const std::vector<uint32_t>& components = _composites.at(*id);
+            if (components.size() >= 3) {
+                return std::array<uint32_t, 3> { components[0], components[1], components[2] };
+            }
+        }
+
+        return _localSizeIds;
+    }
+
+    std::array<std::string, 3> collectWorkgroupSizeSpecIds() const
+    {
+        std::array<std::string, 3> specIds { "InvalidSpecId", "InvalidSpecId", "InvalidSpecId" };
+
+        if (const std::optional<std::array<uint32_t, 3>> components = workgroupSizeComponentIds()) {
+            for (uint32_t i = 0; i < 3; ++i) {
+                if (const std::optional<uint32_t> specId = decoration((*components)[i], DecorationSpecId)) {
+                    specIds[i] = std::to_string(*specId);
+                }
+            }
+        }
+
+        return specIds;
+    }
+
+    // The WorkgroupSize built-in takes precedence over the execution modes, nullopt when no size is declared
+    // or a component isn't a scalar constant
+    std::optional<std::array<uint32_t, 3>> collectWorkgroupSize() const
+    {
+        if (const std::optional<std::array<uint32_t, 3>> components = workgroupSizeComponentIds()) {
+            std::array<uint32_t, 3> size;
+            for (uint32_t i = 0; i < 3; ++i) {
+                auto it = _constants.find((*components)[i]);
+                if (it == _constants.end()) {
+                    return std::nullopt;
+                }
+                size[i] = it->second;
+            }
+            return size;
+        }
+
+        return _localSize;
+    }
+
+    std::string stageName() const
+    {
+        switch (*_stage) {
+        case 0:
+            return "VK_SHADER_STAGE_VERTEX_BIT";
+        case 1:
+            return "VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT";
+        case 2:
+            return "VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT";
+        case 3:
+            return "VK_SHADER_STAGE_GEOMETRY_BIT";
+        case 4:
+            return "VK_SHADER_STAGE_FRAGMENT_BIT";
+        case 5:
+            return "VK_SHADER_STAGE_COMPUTE_BIT";
+        default:
+            return "VK_SHADER_STAGE_ALL";
+        }
+    }
+
+private:
+    std::vector<uint32_t> _words;
+
+    std::optional<uint32_t> _stage;
+    std::optional<std::array<uint32_t, 3>> _localSize;
+    std::optional<std::array<uint32_t, 3>> _localSizeIds;
+
+    std::unordered_map<uint32_t, Type> _types;
+    std::unordered_map<uint32_t, uint32_t> _constants;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> _composites;
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> _variables; // id, pointer type, storage class
+    std::map<uint32_t, std::unordered_map<uint32_t, uint32_t>> _decorations;
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>>> _memberDecorations;
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <input.spv> <output.hpp> <SymbolName> [--embed]" << std::endl;
+        return 1;
+    }
+
+    const std::filesystem::path input = std::filesystem::absolute(argv[1]);
+    const std::filesystem::path output = argv[2];
+    const std::string symbol = argv[3];
+    const bool embed = argc > 4 && std::string { argv[4] } == "--embed";
+
+    std::ifstream file { input, std::ios::ate | std::ios::binary };
+    if (!file.is_open()) {
+        std::cerr << "Failed to open " << input << std::endl;
+        return 1;
+    }
+
+    const size_t size = file.tellg();
+    if (size % sizeof(uint32_t) != 0) {
+        std::cerr << input << " is not a valid SPIR-V binary" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> words(size / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(words.data()), size);
+
+    Module module { std::move(words) };
+    if (!module.parse()) {
+        std::cerr << "Failed to reflect " << input << std::endl;
+        return 1;
+    }
+
+    std::ofstream out { output };
+    if (!out.is_open()) {
+        std::cerr << "Failed to open " << output << " for writing" << std::endl;
+        return 1;
+    }
+
+    module.emit(out, symbol, input, embed);
+
+    return 0;
+}